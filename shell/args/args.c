@@ -1,19 +1,11 @@
 #include "args.h"
+#include "../../timeslime.h"
 #include "../string_literals.h"
 #include "../logger.h"
 
 
 args_t args_parse(int argc, char **argv)
 {
-    // Copy the arguments
-    char **args = NULL;
-    args = (char**)malloc(sizeof(char*) * (argc + 1));
-    int i;
-    for (i = 1; i < argc; i++)
-        args[i - 1] = argv[i];
-
-    int num_args = argc - 1; // Adjust because the filename was dropped
-
     // Create parsed args result and set defaults
     args_t result;
     result.help = ARGS_False;
@@ -22,33 +14,57 @@ args_t args_parse(int argc, char **argv)
     result.modifier1 = NULL;
     result.modifier2 = NULL;
     result.modifier3 = NULL;
+    result.num_options = 0;
 
-    if (num_args > 0)
+    // Split options from positional arguments, skipping the filename
+    char *positional[4] = { NULL, NULL, NULL, NULL };
+    int num_positional = 0;
+    int i;
+    for (i = 1; i < argc; i++)
     {
-        result.action = args[0];
-        if (strcmp(HELP_ACTION, args[0]) == 0)
+        if (strncmp(argv[i], ARGS_OPTION_PREFIX, strlen(ARGS_OPTION_PREFIX)) == 0)
         {
-            result.help = ARGS_True;
-            return result; // Nothing else matters
+            if (result.num_options < ARGS_MAX_OPTIONS)
+                result.options[result.num_options++] = argv[i] + strlen(ARGS_OPTION_PREFIX);
+            else
+                result.error = 1;
         }
+        else if (num_positional < 4)
+            positional[num_positional++] = argv[i];
+    }
 
-        if (num_args > 1)
-            result.modifier1 = args[1];
-        if (num_args > 2)
-            result.modifier2 = args[2];
-        if (num_args > 3)
-            result.modifier3 = args[3];
+    result.action = positional[0];
+    if (result.action != NULL && strcmp(HELP_ACTION, result.action) == 0)
+    {
+        result.help = ARGS_True;
+        return result; // Nothing else matters
     }
 
-    free(args);
+    result.modifier1 = positional[1];
+    result.modifier2 = positional[2];
+    result.modifier3 = positional[3];
 
     return result;
 }
 
-// Sections
-#define YEAR    0
-#define MONTH   1
-#define DAY     2
+/* Get the value of an option passed as --name=value (or "" for --name) */
+char* args_get_option(args_t args, char *name)
+{
+    int len = strlen(name);
+    int i;
+    for (i = 0; i < args.num_options; i++)
+    {
+        if (strncmp(args.options[i], name, len) != 0)
+            continue;
+
+        if (args.options[i][len] == '\0')
+            return args.options[i] + len;
+        if (args.options[i][len] == '=')
+            return args.options[i] + len + 1;
+    }
+
+    return NULL;
+}
 
 /* Parse a date */
 date_t args_parse_date(char *dateStr)
@@ -60,75 +76,25 @@ date_t args_parse_date(char *dateStr)
     date.month = 0;
     date.day = 0;
     date.year = 0;
-    strcpy(date.str, dateStr);
+    strncpy(date.str, dateStr, sizeof(date.str) - 1);
+    date.str[sizeof(date.str) - 1] = '\0';
 
     if (strcmp(dateStr, TODAY) == 0)
         return date;
 
-    char running[256] = "";
-    int tmp = 0;
-    int section = YEAR;
-    int i;
-    for (i = 0; i <= strlen(dateStr); i++)
+    TIMESLIME_DATE_t parsed;
+    TIMESLIME_STATUS_t status = TimeSlime_ParseDate(dateStr, &parsed);
+    if (status != TIMESLIME_OK)
     {
-        // - and / are valid separators
-        if (dateStr[i] == '/' || dateStr[i] == '-' || dateStr[i] == '\0')
-        {
-            log_debug("Found Date Separator: %c, read: %s", dateStr[i], running);
-            tmp = atoi(running);
-
-            if (section == YEAR)
-            {
-                if (tmp < 1000)
-                {
-                    log_error("Invalid year, %d; dates must be in the format YYYY/MM/DD", tmp);
-                    date.error = ARGS_True;
-                    return date;
-                }
-
-                date.year = tmp;
-                log_debug("Year: %d", date.year);
-            }
-            else if (section == MONTH)
-            {
-                if (tmp < 1 || tmp > 12)
-                {
-                    log_error("Invalid month, %d; dates must be in the format YYYY/MM/DD", tmp);
-                    date.error = ARGS_True;
-                    return date;
-                }
-
-                date.month = tmp;
-                log_debug("Month: %d", date.month);
-            }
-            else if (section == DAY)
-            {
-                if (tmp < 1 || tmp > 31)
-                {
-                    log_error("Invalid day, %d; dates must be in the format YYYY/MM/DD", tmp);
-                    date.error = ARGS_True;
-                    return date;
-                }
-
-                date.day = tmp;
-                log_debug("Day: %d", date.day);
-                break;
-            }
-
-            section++;
-            running[0] = '\0';
-        }
-        else {
-            // Add to running string
-            int len = strlen(running);
-            running[len] = dateStr[i];
-            running[len + 1] = '\0';
-        }
+        log_error("Invalid date, %s (%s); dates must be in the format YYYY/MM/DD", dateStr, TimeSlime_StatusCode(status));
+        date.error = ARGS_True;
+        return date;
     }
 
-#ifdef DEBUG
-    log_dull("%c", '\0');
-#endif
+    date.year = parsed.year;
+    date.month = parsed.month;
+    date.day = parsed.day;
+    log_debug("Year: %d, Month: %d, Day: %d", date.year, date.month, date.day);
 
     return date;
 }
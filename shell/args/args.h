@@ -14,6 +14,9 @@
 #define ARGS_True    1
 typedef char args_bool_t;
 
+#define ARGS_MAX_OPTIONS    16
+#define ARGS_OPTION_PREFIX  "--"
+
 typedef struct _args_t {
     args_bool_t help;
     char *action;
@@ -21,6 +24,10 @@ typedef struct _args_t {
     char *modifier2;
     char *modifier3;
 
+    /* --name or --name=value arguments, in any position */
+    char *options[ARGS_MAX_OPTIONS];
+    int num_options;
+
     int error;
 } args_t;
 
@@ -35,6 +42,9 @@ typedef struct _date_t {
 /* Parse the command line arguments */
 args_t args_parse(int argc, char **argv);
 
+/* Get the value of a --name=value option, "" for a --name flag, or NULL when it was not passed */
+char* args_get_option(args_t args, char *name);
+
 /* Parse into a date */
 date_t args_parse_date(char *date);
 
@@ -7,6 +7,24 @@
 #include "string_literals.h"
 #ifndef _WIN32
 #include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <glob.h>
+#include <signal.h>
+#include <sys/wait.h>
+#define make_directory(path)    mkdir(path, 0700)
+#define remove_directory(path)  rmdir(path)
+#define process_id()            getpid()
+#define sleep_ms(ms)            usleep((ms) * 1000)
+#else
+#include <direct.h>
+#include <process.h>
+#include <windows.h>
+#define make_directory(path)    _mkdir(path)
+#define remove_directory(path)  _rmdir(path)
+#define process_id()            _getpid()
+#define sleep_ms(ms)            Sleep(ms)
 #endif
 
 static TIMESLIME_STATUS_t status;
@@ -14,6 +32,35 @@ static TIMESLIME_STATUS_t status;
 static void perform_add_action(args_t args);
 static void perform_clock_action(args_t args);
 static void perform_report_action(args_t args);
+static void print_report(TIMESLIME_REPORT_t *report, void *title);
+static void print_project_report(TIMESLIME_PROJECT_REPORT_t *report, char *title);
+static void perform_list_action(args_t args);
+static void perform_audit_action(args_t args);
+static void perform_analyze_action(args_t args);
+static void perform_compact_action(args_t args);
+static void perform_verify_action(args_t args);
+static void print_problem(int id, int problems, int repaired, void *userdata);
+static void perform_payroll_action(args_t args);
+static void print_payroll_period(TIMESLIME_PAYROLL_PERIOD_t *period, void *userdata);
+static void perform_changes_action(args_t args);
+static void perform_sync_action(args_t args);
+static int perform_status_action(char *base_folder);
+static void perform_autotune_action(char *base_folder);
+static void perform_benchmark_action(char *base_folder);
+static void attach_databases(char *pattern);
+static int benchmark_profile(char *folder, char *profile, double *write_ms, double *report_ms);
+static void remove_scratch_folder(char *folder);
+static void perform_crashtest_action(char *base_folder);
+static int crash_profile(char *folder, char *profile, int *acknowledged, double *ops_per_second, int *lost, int *corrupt);
+static TIMESLIME_DATETIME_t crash_time(int slot, int second);
+static int mark_entry(TIMESLIME_ENTRY_t *entry, void *marks);
+static void count_damage(int id, int problems, int repaired, void *damaged);
+static void perform_contention_action(char *base_folder);
+static int contention_round(char *folder, int writers, int *acknowledged, int *busy, double *writes_per_second, int *rows);
+static int count_entry(TIMESLIME_ENTRY_t *entry, void *count);
+static void perform_parsebench_action(void);
+static double now_ms(void);
+static int dates_in_order(date_t start, date_t end);
 static void display_help(void);
 
 /**
@@ -22,12 +69,30 @@ static void display_help(void);
 int main(int argc, char *argv[])
 {
 
-    log_dull("==== Time Slime ====\n")
-
     // Parse command line arguments
     args_t parsed_args;
     parsed_args = args_parse(argc, argv);
 
+    // Options past ARGS_MAX_OPTIONS were dropped, running without them could do the wrong thing
+    if (parsed_args.error)
+    {
+        log_error("Too many options, at most %d can be given", ARGS_MAX_OPTIONS);
+        return -1;
+    }
+
+    // Status is printed on its own for use in shell prompts
+    if (!parsed_args.help && parsed_args.action != NULL && strcmp(parsed_args.action, STATUS_ACTION) == 0)
+    {
+        char *base_folder = args_get_directory_of_executable(argv[0]);
+        if (base_folder == NULL)
+            return -1;
+
+        int result = perform_status_action(base_folder);
+        free(base_folder);
+        return result;
+    }
+
+    log_dull("==== Time Slime ====\n")
 
     if (parsed_args.help)
     {
@@ -42,6 +107,69 @@ int main(int argc, char *argv[])
             return 0;
         }
 
+        // Storage backend
+        char *backend_name = args_get_option(parsed_args, BACKEND_OPTION);
+        if (backend_name != NULL)
+        {
+            TIMESLIME_BACKEND_t *backend = TimeSlime_GetBackend(backend_name);
+            if (backend == NULL)
+            {
+                log_error("Unknown storage backend '%s', must be 'sqlite' or 'log'", backend_name);
+                free(base_folder);
+                return -1;
+            }
+            TimeSlime_SetBackend(backend);
+        }
+
+        if (parsed_args.action != NULL && strcmp(parsed_args.action, AUTOTUNE_ACTION) == 0)
+        {
+            // Works on its own scratch storage, never on the real time sheet
+            perform_autotune_action(base_folder);
+            free(base_folder);
+            return 0;
+        }
+
+        if (parsed_args.action != NULL && strcmp(parsed_args.action, BENCHMARK_ACTION) == 0)
+        {
+            // Scratch storage as well, and every backend in turn whatever --backend says
+            perform_benchmark_action(base_folder);
+            free(base_folder);
+            return 0;
+        }
+
+        if (parsed_args.action != NULL && strcmp(parsed_args.action, CRASHTEST_ACTION) == 0)
+        {
+            // Also scratch storage only, the workers are killed on purpose
+            perform_crashtest_action(base_folder);
+            free(base_folder);
+            return 0;
+        }
+
+        if (parsed_args.action != NULL && strcmp(parsed_args.action, PARSEBENCH_ACTION) == 0)
+        {
+            // Needs no storage at all
+            perform_parsebench_action();
+            free(base_folder);
+            return 0;
+        }
+
+        if (parsed_args.action != NULL && strcmp(parsed_args.action, CONTENTION_ACTION) == 0)
+        {
+            // Scratch storage again, shared by every writer
+            perform_contention_action(base_folder);
+            free(base_folder);
+            return 0;
+        }
+
+        // Storage tuning profile
+        char *profile = args_get_option(parsed_args, PROFILE_OPTION);
+        if (profile != NULL && TimeSlime_Configure(profile) != TIMESLIME_OK)
+        {
+            log_error("Unknown storage profile '%s', must be 'durable', 'balanced', 'throughput' or 'readmostly'", profile);
+            free(base_folder);
+            return -1;
+        }
+
         status = TimeSlime_Initialize(base_folder);
         if (status != TIMESLIME_OK)
         {
@@ -49,6 +177,11 @@ int main(int argc, char *argv[])
             return -1;
         }
 
+        // Other time sheet files to include in reports
+        char *attach_pattern = args_get_option(parsed_args, ATTACH_OPTION);
+        if (attach_pattern != NULL)
+            attach_databases(attach_pattern);
+
         if (parsed_args.action != NULL && strcmp(parsed_args.action, ADD_ACTION) == 0)
             perform_add_action(parsed_args);
 
@@ -58,6 +191,30 @@ int main(int argc, char *argv[])
         else if (parsed_args.action != NULL && strcmp(parsed_args.action, REPORT_ACTION) == 0)
             perform_report_action(parsed_args);
 
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, LIST_ACTION) == 0)
+            perform_list_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, AUDIT_ACTION) == 0)
+            perform_audit_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, ANALYZE_ACTION) == 0)
+            perform_analyze_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, COMPACT_ACTION) == 0)
+            perform_compact_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, VERIFY_ACTION) == 0)
+            perform_verify_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, PAYROLL_ACTION) == 0)
+            perform_payroll_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, CHANGES_ACTION) == 0)
+            perform_changes_action(parsed_args);
+
+        else if (parsed_args.action != NULL && strcmp(parsed_args.action, SYNC_ACTION) == 0)
+            perform_sync_action(parsed_args);
+
         if (status != TIMESLIME_OK)
             printf("Error: %s\n", TimeSlime_StatusCode(status));
 
@@ -100,18 +257,22 @@ static void perform_add_action(args_t args)
     // Show message for what is about to happen
     log_info("Adding %.2f hour(s) to the time sheet for %s", toAdd, date);
 
-    if (strcmp(date, TODAY) == 0)
+    char *project = args_get_option(args, PROJECT_OPTION);
+    char *key = args_get_option(args, KEY_OPTION);
+    TIMESLIME_DATE_t addTo = TIMESLIME_DATE_NOW;
+    if (strcmp(date, TODAY) != 0)
     {
-        status = TimeSlime_AddHours(toAdd, TIMESLIME_DATE_NOW);
-    }
-    else {
         date_t parsed = args_parse_date(date);
-        if (!parsed.error)
-        {
-            status = TimeSlime_AddHours(toAdd, (TIMESLIME_DATE_t){ parsed.year, parsed.month, parsed.day });
-        }
+        if (parsed.error)
+            return;
+        addTo = (TIMESLIME_DATE_t){ parsed.year, parsed.month, parsed.day };
     }
 
+    if (key != NULL)
+        status = TimeSlime_AddHoursKeyed(key, toAdd, addTo, project);
+    else
+        status = TimeSlime_AddProjectHours(toAdd, addTo, project);
+
 }
 
 /* Clock in and clock out of the time sheet */
@@ -134,12 +295,38 @@ static void perform_clock_action(args_t args)
     // Show message for what is about to happen
     log_info("Clocking %s", direction);
 
+    // With a key, a retried clock in or out is only recorded once
+    char *key = args_get_option(args, KEY_OPTION);
+
+    // A named job runs its own timer next to the others
+    char *job = args.modifier2;
+    if (job != NULL)
+    {
+        if (key != NULL)
+        {
+            log_error("--%s can not be used with a job", KEY_OPTION);
+            return;
+        }
+
+        if (strcmp(direction, CLOCK_IN) == 0)
+            status = TimeSlime_ClockInJob(TIMESLIME_TIME_NOW, job);
+        else
+            status = TimeSlime_ClockOutJob(TIMESLIME_TIME_NOW, job);
+        return;
+    }
+
     if (strcmp(direction, CLOCK_IN) == 0)
     {
-        status = TimeSlime_ClockIn(TIMESLIME_TIME_NOW);
+        if (key != NULL)
+            status = TimeSlime_ClockInKeyed(key, TIMESLIME_TIME_NOW, args_get_option(args, PROJECT_OPTION));
+        else
+            status = TimeSlime_ClockInProject(TIMESLIME_TIME_NOW, args_get_option(args, PROJECT_OPTION));
     }
     else {
-        status = TimeSlime_ClockOut(TIMESLIME_TIME_NOW);
+        if (key != NULL)
+            status = TimeSlime_ClockOutKeyed(key, TIMESLIME_TIME_NOW);
+        else
+            status = TimeSlime_ClockOut(TIMESLIME_TIME_NOW);
     }
 }
 
@@ -168,25 +355,79 @@ static void perform_report_action(args_t args)
         return;
 
     // Verify that dates are in the correct order
-    if (strcmp(startDate.str, TODAY) != 0 && strcmp(endDate.str, TODAY) != 0)
+    if (!dates_in_order(startDate, endDate))
     {
-        if (
-                (endDate.month < startDate.month && endDate.year == startDate.year) || // Same year, but earlier month
-                (endDate.day < startDate.day && endDate.year == startDate.year && endDate.month == startDate.month) || // Same month and year, but earlier day
-                (endDate.year < startDate.year) // Earlier year
-            )
-        {
-            log_error("Dates in wrong order");
-            return;
-        }
+        log_error("Dates in wrong order");
+        return;
     }
 
     TIMESLIME_REPORT_t *report;
     TIMESLIME_DATE_t start = { startDate.year, startDate.month, startDate.day };
     TIMESLIME_DATE_t end = { endDate.year, endDate.month, endDate.day };
+
+    char title[600];
+    sprintf(title, "Time Slime report for %s to %s:", startDate.str, endDate.str);
+
+    char *by = args_get_option(args, BY_OPTION);
+    if (by != NULL)
+    {
+        if (strcmp(by, BY_PROJECT) != 0)
+        {
+            log_error("Reports can only be grouped by '%s'", BY_PROJECT);
+            return;
+        }
+
+        TIMESLIME_PROJECT_REPORT_t *projectReport;
+        status = TimeSlime_GetProjectReport(start, end, &projectReport);
+        if (status != TIMESLIME_OK)
+            return;
+
+        print_project_report(projectReport, title);
+        TimeSlime_FreeProjectReport(&projectReport);
+        return;
+    }
+
+    if (args_get_option(args, TOTAL_OPTION) != NULL)
+    {
+        // Only the total line, from running totals instead of every entry in the range
+        double total;
+        status = TimeSlime_GetTotalHours(start, end, &total);
+        if (status == TIMESLIME_OK)
+            printf("Total Hours: %0.2f\n", total);
+        return;
+    }
+
+    if (args_get_option(args, WATCH_OPTION) != NULL)
+    {
+        // Print the report again whenever entries change, until interrupted
+        TIMESLIME_WATCH_t *watch;
+        int changed;
+
+        status = TimeSlime_WatchReport(start, end, print_report, title, &watch);
+        while (status == TIMESLIME_OK)
+        {
+            sleep_ms(WATCH_INTERVAL_MS);
+            status = TimeSlime_PollWatch(watch, &changed);
+        }
+
+        TimeSlime_FreeWatch(&watch);
+        return;
+    }
+
     status = TimeSlime_GetReport(start, end, &report);
+    if (status != TIMESLIME_OK)
+        return;
+
+    print_report(report, title);
+    TimeSlime_FreeReport(&report);
+}
 
-    log_dull("Time Slime report for %s to %s:", startDate.str, endDate.str);
+/**
+ * Print a report under a title
+ */
+static void print_report(TIMESLIME_REPORT_t *report, void *title)
+{
+    log_dull("%s", (char*)title);
 
     int i;
     for (i = 0; i < report->NumberOfEntries; i++)
@@ -196,38 +437,1218 @@ static void perform_report_action(args_t args)
 
     printf("\nTotal Hours: %0.2f\n", report->TotalHours);
     printf("\n");
-    TimeSlime_FreeReport(&report);
+    fflush(stdout);
 }
 
+/**
+ * Print a report by project under a title
+ */
+static void print_project_report(TIMESLIME_PROJECT_REPORT_t *report, char *title)
+{
+    log_dull("%s", title);
 
-/* Help Screen */
-void display_help(void)
+    int i;
+    for (i = 0; i < report->NumberOfProjects; i++)
+    {
+        printf("\t%s: %0.2f\n", (report->Projects[i].Project[0] != '\0') ? report->Projects[i].Project : "(no project)", report->Projects[i].Hours);
+    }
+
+    printf("\nTotal Hours: %0.2f\n", report->TotalHours);
+    printf("\n");
+}
+
+
+/* Page through the raw time sheet entries */
+static void perform_list_action(args_t args)
 {
-    printf("Author: %s\n", AUTHOR);
-    printf("Version: %s\n", TIMESLIME_VERSION_STR);
-    printf("%s\n\n\n", DESCRIPTION);
+    TIMESLIME_FILTER_t filter = TIMESLIME_FILTER_ALL;
 
-    printf("Usage:\n");
-    printf("\t%s [action] [arguments...]\n\n", PROGRAM_NAME);
+    if (args.modifier1 != NULL)
+    {
+        date_t startDate = args_parse_date(args.modifier1);
+        if (startDate.error)
+            return;
+        filter.start = (TIMESLIME_DATE_t){ startDate.year, startDate.month, startDate.day };
 
-    printf("Actions:\n");
+        date_t endDate = args_parse_date(args.modifier2 != NULL ? args.modifier2 : TODAY);
+        if (endDate.error)
+            return;
+        filter.end = (TIMESLIME_DATE_t){ endDate.year, endDate.month, endDate.day };
+
+        if (!dates_in_order(startDate, endDate))
+        {
+            log_error("Dates in wrong order");
+            return;
+        }
+    }
+
+    char *kind = args_get_option(args, KIND_OPTION);
+    if (kind != NULL && strcmp(kind, KIND_CLOCK) == 0)
+        filter.kind = TIMESLIME_ENTRY_KIND_CLOCK;
+    else if (kind != NULL && strcmp(kind, KIND_HOURS) == 0)
+        filter.kind = TIMESLIME_ENTRY_KIND_HOURS;
+    else if (kind != NULL && strcmp(kind, ALL) != 0)
+    {
+        log_error("Invalid --%s, must be '%s', '%s' or '%s'", KIND_OPTION, KIND_CLOCK, KIND_HOURS, ALL);
+        return;
+    }
+
+    char *state = args_get_option(args, STATE_OPTION);
+    if (state != NULL && strcmp(state, STATE_OPEN) == 0)
+        filter.state = TIMESLIME_ENTRY_STATE_OPEN;
+    else if (state != NULL && strcmp(state, STATE_CLOSED) == 0)
+        filter.state = TIMESLIME_ENTRY_STATE_CLOSED;
+    else if (state != NULL && strcmp(state, ALL) != 0)
+    {
+        log_error("Invalid --%s, must be '%s', '%s' or '%s'", STATE_OPTION, STATE_OPEN, STATE_CLOSED, ALL);
+        return;
+    }
+
+    char *after = args_get_option(args, AFTER_OPTION);
+    char *limit = args_get_option(args, LIMIT_OPTION);
+    int limitCount = (limit != NULL) ? atoi(limit) : 50;
+
+    TIMESLIME_ENTRIES_t *entries;
+    status = TimeSlime_ListEntries(filter, (after != NULL) ? atoi(after) : 0, limitCount, &entries);
+    if (status != TIMESLIME_OK)
+        return;
+
+    int i;
+    for (i = 0; i < entries->NumberOfEntries; i++)
+    {
+        TIMESLIME_ENTRY_t *entry = &entries->Entries[i];
+        if (strcmp(entry->ClockInTime, "NULL") != 0)
+            printf("\t#%d %s: %s -> %s (%0.2f)\n", entry->ID, entry->TimeSheetDate, entry->ClockInTime, entry->ClockOutTime, entry->Hours);
+        else
+            printf("\t#%d %s: added %0.2f\n", entry->ID, entry->TimeSheetDate, entry->Hours);
+    }
+
+    // A full page means there may be more
+    if (entries->NumberOfEntries > 0 && entries->NumberOfEntries == limitCount)
+        printf("\nNext page: --%s=%d\n", AFTER_OPTION, entries->Entries[entries->NumberOfEntries - 1].ID);
 
-    printf("\t%s\t %s\n", ADD_ACTION, ADD_ACTION_DESCRIPTION);
-    printf("\t%s\t %s\n", CLOCK_ACTION, CLOCK_ACTION_DESCRIPTION);
-    printf("\t%s\t %s\n", REPORT_ACTION, REPORT_ACTION_DESCRIPTION);
     printf("\n");
+    TimeSlime_FreeEntries(&entries);
+}
 
-    printf("\t%s\t %s\n\n", HELP_ACTION, HELP_ACTION_DESCRIPTION);
+/* Look for problems in the time sheet */
+static void perform_audit_action(args_t args)
+{
+    if (args.modifier1 == NULL || strcmp(args.modifier1, AUDIT_OVERLAPS) != 0)
+    {
+        log_error("'audit' action needs an additional parameter: 'overlaps'");
+        return;
+    }
 
-    printf("\n%s Action Usage:\n", ADD_ACTION);
-    printf("\t%s add (+|-)[0-9]\n", PROGRAM_NAME);
-    printf("\t%s add (+|-)[0-9] YYYY/MM/DD\n\n", PROGRAM_NAME);
+    if (args.modifier2 == NULL)
+    {
+        log_error("'audit overlaps' action needs another parameter, the start date");
+        return;
+    }
 
-    printf("%s Action Usage:\n", CLOCK_ACTION);
-    printf("\t%s clock (in|out)\n\n", PROGRAM_NAME);
+    if (args.modifier3 == NULL)
+        args.modifier3 = TODAY;
 
-    printf("%s Action Usage:\n", REPORT_ACTION);
-    printf("\t%s report YYYY/MM/DDD YYYY/MM/DDD\n", PROGRAM_NAME);
+    date_t startDate = args_parse_date(args.modifier2);
+    if (startDate.error)
+        return;
+
+    date_t endDate = args_parse_date(args.modifier3);
+    if (endDate.error)
+        return;
+
+    if (!dates_in_order(startDate, endDate))
+    {
+        log_error("Dates in wrong order");
+        return;
+    }
+
+    TIMESLIME_ENTRIES_t *entries;
+    TIMESLIME_DATE_t start = { startDate.year, startDate.month, startDate.day };
+    TIMESLIME_DATE_t end = { endDate.year, endDate.month, endDate.day };
+    status = TimeSlime_FindOverlaps(start, end, &entries);
+    if (status != TIMESLIME_OK)
+        return;
+
+    log_dull("Overlapping clock sessions for %s to %s:", startDate.str, endDate.str);
+
+    int i;
+    for (i = 0; i < entries->NumberOfEntries; i++)
+    {
+        printf("\t#%d: %s -> %s\n", entries->Entries[i].ID, entries->Entries[i].ClockInTime, entries->Entries[i].ClockOutTime);
+    }
+
+    printf("\nOverlapping Sessions: %d\n", entries->NumberOfEntries);
+    printf("\n");
+    TimeSlime_FreeEntries(&entries);
+}
+
+/* Checks that the end date does not come before the start date */
+static int dates_in_order(date_t start, date_t end)
+{
+    if (strcmp(start.str, TODAY) == 0 || strcmp(end.str, TODAY) == 0)
+        return 1;
+
+    return !(
+            (end.month < start.month && end.year == start.year) || // Same year, but earlier month
+            (end.day < start.day && end.year == start.year && end.month == start.month) || // Same month and year, but earlier day
+            (end.year < start.year) // Earlier year
+        );
+}
+
+
+/**
+ * Print the clock status on one line, read from the status file without opening the time sheet.
+ * The status file is only missing before the first run, initializing writes it.
+ */
+static int perform_status_action(char *base_folder)
+{
+    TIMESLIME_CLOCK_STATUS_t clock_status;
+
+    status = TimeSlime_GetStatus(base_folder, &clock_status);
+    if (status == TIMESLIME_NO_STATUS)
+    {
+        status = TimeSlime_Initialize(base_folder);
+        TimeSlime_Close();
+        if (status == TIMESLIME_OK)
+            status = TimeSlime_GetStatus(base_folder, &clock_status);
+    }
+
+    if (status != TIMESLIME_OK)
+    {
+        printf("Error: %s\n", TimeSlime_StatusCode(status));
+        return -1;
+    }
+
+    int today_minutes = (int)(clock_status.TodayHours * 60);
+    if (clock_status.ClockedIn)
+    {
+        int session_minutes = (int)(clock_status.SessionHours * 60);
+        printf("clocked in for %dh%02dm, %dh%02dm today\n", session_minutes / 60, session_minutes % 60, today_minutes / 60, today_minutes % 60);
+    }
+    else
+        printf("clocked out, %dh%02dm today\n", today_minutes / 60, today_minutes % 60);
+
+    return 0;
+}
+
+/**
+ * Show work patterns for a date range, or the whole time sheet
+ */
+static void perform_analyze_action(args_t args)
+{
+    TIMESLIME_DATE_t start = TIMESLIME_DATE_ANY;
+    TIMESLIME_DATE_t end = TIMESLIME_DATE_ANY;
+    char *weekdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+    if (args.modifier1 != NULL)
+    {
+        date_t startDate = args_parse_date(args.modifier1);
+        if (startDate.error)
+            return;
+        start = (TIMESLIME_DATE_t){ startDate.year, startDate.month, startDate.day };
+
+        date_t endDate = args_parse_date(args.modifier2 != NULL ? args.modifier2 : TODAY);
+        if (endDate.error)
+            return;
+        end = (TIMESLIME_DATE_t){ endDate.year, endDate.month, endDate.day };
+
+        if (!dates_in_order(startDate, endDate))
+        {
+            log_error("Dates in wrong order");
+            return;
+        }
+    }
+
+    TIMESLIME_ANALYSIS_t analysis;
+    status = TimeSlime_Analyze(start, end, &analysis);
+    if (status != TIMESLIME_OK)
+        return;
+
+    printf("Total Hours: %0.2f over %d day(s), %d session(s)\n\n", analysis.TotalHours, analysis.NumberOfDays, analysis.NumberOfSessions);
+
+    printf("Hours per day:\t last 7 days %0.2f, last 30 days %0.2f\n", analysis.Average7Days, analysis.Average30Days);
+    printf("Busiest stretch:\t 7 days %0.2f, 30 days %0.2f\n", analysis.PeakAverage7Days, analysis.PeakAverage30Days);
+    printf("Session length:\t median %0.2f, 90th percentile %0.2f\n", analysis.MedianSessionHours, analysis.P90SessionHours);
+    printf("Breaks:\t\t %d, average %0.2f, longest %0.2f\n\n", analysis.NumberOfGaps, analysis.AverageGapHours, analysis.LongestGapHours);
+
+    int i;
+    int hour;
+    if (analysis.NumberOfLongest > 0)
+        printf("Longest sessions:\n");
+    for (i = 0; i < analysis.NumberOfLongest; i++)
+        printf("\t#%d %s -> %s (%0.2f)\n", analysis.Longest[i].ID, analysis.Longest[i].ClockInTime, analysis.Longest[i].ClockOutTime, analysis.Longest[i].Hours);
+
+    // Heatmap, one character per hour of the day
+    printf("\nHeatmap (hour of day, . < 1h  : < 10h  # more):\n\t    ");
+    for (hour = 0; hour < 24; hour += 6)
+        printf("%-6d", hour);
+    printf("\n");
+    for (i = 0; i < 7; i++)
+    {
+        printf("\t%s ", weekdays[i]);
+        for (hour = 0; hour < 24; hour++)
+        {
+            float hours = analysis.Heatmap[i][hour];
+            printf("%c", (hours == 0) ? ' ' : (hours < 1) ? '.' : (hours < 10) ? ':' : '#');
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+/**
+ * Compacts old clock sessions into daily totals, or converts an older database once so compacting can shrink it
+ */
+static void perform_compact_action(args_t args)
+{
+    TIMESLIME_COMPACTION_t result;
+
+    if (args_get_option(args, CONVERT_OPTION) != NULL)
+    {
+        log_info("Rewriting the time sheet, other programs have to wait until it is done");
+        status = TimeSlime_EnableIncrementalVacuum(&result);
+        if (status != TIMESLIME_OK)
+            return;
+
+        printf("Converted %lld KB to %lld KB, compacting now shrinks the file\n", result.BytesBefore / 1024, result.BytesAfter / 1024);
+        return;
+    }
+
+    int months = (args.modifier1 != NULL) ? atoi(args.modifier1) : 0;
+    if (args.modifier1 != NULL && months <= 0)
+    {
+        log_error("Retention must be a number of months");
+        return;
+    }
+
+    status = TimeSlime_Compact(months, &result);
+    if (status != TIMESLIME_OK)
+        return;
+
+    printf("Compacted %d clock sessions into %d daily totals\n", result.SessionsCompacted, result.DaysCompacted);
+    printf("Reclaimed %lld KB (%lld KB to %lld KB)\n",
+        (result.BytesBefore - result.BytesAfter) / 1024,
+        result.BytesBefore / 1024,
+        result.BytesAfter / 1024
+    );
+
+    if (result.NeedsConversion)
+        log_info("This time sheet predates incremental vacuum, freed space is reused but the file only shrinks after running 'compact --%s' once", CONVERT_OPTION);
+}
+
+/**
+ * Checks the time sheet for broken entries, continuing from where the last run stopped
+ */
+static void perform_verify_action(args_t args)
+{
+    char *limit = args_get_option(args, LIMIT_OPTION);
+    int repair = (args_get_option(args, REPAIR_OPTION) != NULL);
+
+    TIMESLIME_VERIFY_t result;
+    status = TimeSlime_Verify((limit != NULL) ? atoi(limit) : 0, repair, print_problem, NULL, &result);
+    if (status != TIMESLIME_OK)
+        return;
+
+    if (result.EntriesChecked > 0)
+        printf("Checked %d entries (IDs %d to %d): ", result.EntriesChecked, result.FirstID, result.LastID);
+    else
+        printf("Checked 0 entries: ");
+    printf("%d with problems, %d repaired\n", result.Problems, result.Repaired);
+
+    if (result.Finished)
+        printf("Reached the end of the time sheet, the next run starts over\n");
+    else
+        printf("Run again to continue from ID %d\n", result.LastID + 1);
+}
+
+/**
+ * Prints one entry found by verify
+ */
+static void print_problem(int id, int problems, int repaired, void *userdata)
+{
+    printf("Entry %d:", id);
+    if (problems & TIMESLIME_PROBLEM_OPEN)
+        printf(" older open session");
+    if (problems & TIMESLIME_PROBLEM_NEGATIVE)
+        printf(" clocked out before in");
+    if (problems & TIMESLIME_PROBLEM_TOO_LONG)
+        printf(" longer than a day");
+    if (problems & TIMESLIME_PROBLEM_MIXED)
+        printf(" both added hours and clock times");
+    if (problems & TIMESLIME_PROBLEM_DUPLICATE)
+        printf(" duplicate");
+    printf("%s\n", repaired ? " (repaired)" : "");
+}
+
+/**
+ * Shows paid hours for a date range, or the whole time sheet, under the payroll rules
+ */
+static void perform_payroll_action(args_t args)
+{
+    TIMESLIME_DATE_t start = TIMESLIME_DATE_ANY;
+    TIMESLIME_DATE_t end = TIMESLIME_DATE_ANY;
+    TIMESLIME_PAYROLL_RULES_t rules = TIMESLIME_PAYROLL_DEFAULT_RULES;
+    TIMESLIME_PAYROLL_PERIOD_t total;
+    char *option;
+
+    if (args.modifier1 != NULL)
+    {
+        date_t startDate = args_parse_date(args.modifier1);
+        if (startDate.error)
+            return;
+        start = (TIMESLIME_DATE_t){ startDate.year, startDate.month, startDate.day };
+
+        date_t endDate = args_parse_date(args.modifier2 != NULL ? args.modifier2 : TODAY);
+        if (endDate.error)
+            return;
+        end = (TIMESLIME_DATE_t){ endDate.year, endDate.month, endDate.day };
+
+        if (!dates_in_order(startDate, endDate))
+        {
+            log_error("Dates in wrong order");
+            return;
+        }
+    }
+
+    if ((option = args_get_option(args, ROUND_OPTION)) != NULL)
+        rules.RoundMinutes = atoi(option);
+    if ((option = args_get_option(args, DAILY_OPTION)) != NULL)
+        rules.DailyOvertimeHours = (float)atof(option);
+    if ((option = args_get_option(args, WEEKLY_OPTION)) != NULL)
+        rules.WeeklyOvertimeHours = (float)atof(option);
+    if ((option = args_get_option(args, BREAK_OPTION)) != NULL)
+        rules.BreakMinutes = atoi(option);
+    if ((option = args_get_option(args, BREAK_AFTER_OPTION)) != NULL)
+        rules.BreakAfterHours = (float)atof(option);
+    if ((option = args_get_option(args, WEEK_START_OPTION)) != NULL)
+        rules.WeekStart = atoi(option);
+
+    if (rules.RoundMinutes < 0 || rules.BreakMinutes < 0 || rules.WeekStart < 0 || rules.WeekStart > 6)
+    {
+        log_error("Invalid payroll rules");
+        return;
+    }
+
+    printf("%-12s %8s %8s %8s %8s\n", "", "Worked", "Break", "Regular", "Overtime");
+    status = TimeSlime_Payroll(start, end, rules, print_payroll_period, NULL, &total);
+    if (status != TIMESLIME_OK)
+        return;
+
+    print_payroll_period(&total, NULL);
+}
+
+/**
+ * Prints one line of the payroll, weeks and the total are labelled
+ */
+static void print_payroll_period(TIMESLIME_PAYROLL_PERIOD_t *period, void *userdata)
+{
+    char label[TIMESLIME_DATETIME_STR_LENGTH + 8];
+
+    if (period->Kind == TIMESLIME_PAYROLL_WEEK)
+        sprintf(label, "Week");
+    else if (period->Kind == TIMESLIME_PAYROLL_TOTAL)
+        sprintf(label, "Total");
+    else
+        sprintf(label, "%s", period->Start);
+
+    printf("%-12s %8.2f %8.2f %8.2f %8.2f\n", label, period->WorkedHours, period->BreakHours, period->RegularHours, period->OvertimeHours);
+    if (period->Kind == TIMESLIME_PAYROLL_WEEK)
+        printf("\n");
+}
+
+/**
+ * Lists the entries changed since a token, and the token to continue from
+ */
+static void perform_changes_action(args_t args)
+{
+    long long token = (args.modifier1 != NULL) ? atoll(args.modifier1) : 0;
+    char *limit = args_get_option(args, LIMIT_OPTION);
+
+    TIMESLIME_CHANGES_t *changes;
+    status = TimeSlime_ChangesSince(token, (limit != NULL) ? atoi(limit) : 50, &changes);
+    if (status != TIMESLIME_OK)
+        return;
+
+    int i;
+    for (i = 0; i < changes->NumberOfChanges; i++)
+    {
+        TIMESLIME_CHANGE_t *change = &changes->Changes[i];
+        TIMESLIME_ENTRY_t *entry = &change->Entry;
+        if (change->Deleted)
+            printf("	%lld #%d deleted\n", change->Sequence, entry->ID);
+        else if (strcmp(entry->ClockInTime, "NULL") != 0)
+            printf("	%lld #%d %s: %s -> %s (%0.2f) %s\n", change->Sequence, entry->ID, entry->TimeSheetDate, entry->ClockInTime, entry->ClockOutTime, entry->Hours, change->Project);
+        else
+            printf("	%lld #%d %s: added %0.2f %s\n", change->Sequence, entry->ID, entry->TimeSheetDate, entry->Hours, change->Project);
+    }
+
+    printf("\nNext token: %lld\n", changes->NextToken);
+    TimeSlime_FreeChanges(&changes);
+}
+
+/**
+ * Exports the changes made here since the last export, or imports a file exported elsewhere
+ */
+static void perform_sync_action(args_t args)
+{
+    TIMESLIME_SYNC_t result;
+
+    if (args.modifier1 == NULL || args.modifier2 == NULL ||
+        (strcmp(args.modifier1, SYNC_EXPORT) != 0 && strcmp(args.modifier1, SYNC_IMPORT) != 0))
+    {
+        log_error("'sync' action needs '%s' or '%s' and a file", SYNC_EXPORT, SYNC_IMPORT);
+        return;
+    }
+
+    if (strcmp(args.modifier1, SYNC_EXPORT) == 0)
+    {
+        status = TimeSlime_SyncExport(args.modifier2, args_get_option(args, FULL_OPTION) != NULL, &result);
+        if (status == TIMESLIME_OK)
+            printf("Exported %d changes (%lld bytes) to %s\n", result.Changes, result.Bytes, args.modifier2);
+    }
+    else {
+        status = TimeSlime_SyncImport(args.modifier2, &result);
+        if (status == TIMESLIME_OK)
+            printf("Imported %d changes: %d applied, %d skipped for newer changes here\n", result.Changes, result.Applied, result.Conflicts);
+    }
+}
+
+/**
+ * Attaches every time sheet file matching a pattern, such as "archive/20??.db"
+ */
+static void attach_databases(char *pattern)
+{
+    TIMESLIME_STATUS_t attach_status;
+#ifndef _WIN32
+    glob_t matches;
+    size_t i;
+
+    if (glob(pattern, 0, NULL, &matches) != 0)
+    {
+        log_error("No time sheet files match '%s'", pattern);
+        return;
+    }
+
+    for (i = 0; i < matches.gl_pathc; i++)
+    {
+        attach_status = TimeSlime_AttachDatabase(matches.gl_pathv[i]);
+        if (attach_status != TIMESLIME_OK)
+            log_error("Unable to attach '%s': %s", matches.gl_pathv[i], TimeSlime_StatusCode(attach_status));
+    }
+
+    globfree(&matches);
+#else
+    attach_status = TimeSlime_AttachDatabase(pattern);
+    if (attach_status != TIMESLIME_OK)
+        log_error("Unable to attach '%s': %s", pattern, TimeSlime_StatusCode(attach_status));
+#endif
+}
+
+/**
+ * Runs a short clock in/out and report workload against every storage profile
+ * in a scratch folder, then recommends the profile that best fits this machine
+ */
+static void perform_autotune_action(char *base_folder)
+{
+    char *names[] = {
+        TIMESLIME_PROFILE_DURABLE,
+        TIMESLIME_PROFILE_BALANCED,
+        TIMESLIME_PROFILE_THROUGHPUT,
+        TIMESLIME_PROFILE_READMOSTLY
+    };
+    int number_of_profiles = sizeof(names) / sizeof(names[0]);
+    double write_ms[4];
+    double report_ms[4];
+
+    char folder[PATH_MAX];
+    sprintf(folder, "%s%s%s%d", base_folder, TIMESLIME_FILE_PATH_SEPARATOR, AUTOTUNE_FOLDER, (int)process_id());
+
+    log_info("Benchmarking %d clock in/out pairs and %d reports per profile...", AUTOTUNE_SESSIONS, AUTOTUNE_REPORTS);
+    printf("\t%-12s %12s %12s\n", "profile", "write (ms)", "report (ms)");
+
+    int i;
+    for (i = 0; i < number_of_profiles; i++)
+    {
+        if (!benchmark_profile(folder, names[i], &write_ms[i], &report_ms[i]))
+        {
+            printf("Error: %s\n", TimeSlime_StatusCode(status));
+            return;
+        }
+        printf("\t%-12s %12.3f %12.3f\n", names[i], write_ms[i], report_ms[i]);
+    }
+
+    // Safest profile that is still fast enough, otherwise trade durability for speed
+    char *recommended;
+    if (write_ms[0] <= AUTOTUNE_TARGET_MS)
+        recommended = names[0];
+    else if (report_ms[3] < report_ms[1] * 0.8)
+        recommended = names[3];
+    else if (write_ms[1] <= AUTOTUNE_TARGET_MS)
+        recommended = names[1];
+    else
+        recommended = names[2];
+
+    printf("\n");
+    log_info("Recommended: --%s=%s", PROFILE_OPTION, recommended);
+}
+
+/**
+ * Runs the autotune workload against each storage backend under every profile, side by side,
+ * so the log backend can be weighed against SQLITE with the same durability settings
+ */
+static void perform_benchmark_action(char *base_folder)
+{
+    char *backends[] = { "sqlite", "log" };
+    char *names[] = {
+        TIMESLIME_PROFILE_DURABLE,
+        TIMESLIME_PROFILE_BALANCED,
+        TIMESLIME_PROFILE_THROUGHPUT,
+        TIMESLIME_PROFILE_READMOSTLY
+    };
+    int number_of_backends = sizeof(backends) / sizeof(backends[0]);
+    int number_of_profiles = sizeof(names) / sizeof(names[0]);
+    double write_ms[2];
+    double report_ms[2];
+
+    char folder[PATH_MAX];
+    sprintf(folder, "%s%s%s%d", base_folder, TIMESLIME_FILE_PATH_SEPARATOR, BENCHMARK_FOLDER, (int)process_id());
+
+    log_info("Benchmarking %d clock in/out pairs and %d reports per backend and profile...", AUTOTUNE_SESSIONS, AUTOTUNE_REPORTS);
+    printf("\t%-12s %-8s %12s %12s\n", "profile", "backend", "write (ms)", "report (ms)");
+
+    int i, j;
+    for (i = 0; i < number_of_profiles; i++)
+    {
+        for (j = 0; j < number_of_backends; j++)
+        {
+            TimeSlime_SetBackend(TimeSlime_GetBackend(backends[j]));
+            if (!benchmark_profile(folder, names[i], &write_ms[j], &report_ms[j]))
+            {
+                printf("Error: %s\n", TimeSlime_StatusCode(status));
+                return;
+            }
+            printf("\t%-12s %-8s %12.3f %12.3f\n", names[i], backends[j], write_ms[j], report_ms[j]);
+        }
+
+        // Speed up of the log backend over SQLITE with the same profile
+        if (write_ms[1] > 0 && report_ms[1] > 0)
+            printf("\t%-12s %-8s %11.1fx %11.1fx\n", "", "speedup", write_ms[0] / write_ms[1], report_ms[0] / report_ms[1]);
+    }
+    printf("\n");
+}
+
+/**
+ * Times one profile in a fresh scratch folder, which is removed afterwards. Returns 0 on error
+ */
+static int benchmark_profile(char *folder, char *profile, double *write_ms, double *report_ms)
+{
+    int i;
+
+    make_directory(folder);
+
+    status = TimeSlime_Configure(profile);
+    if (status == TIMESLIME_OK)
+        status = TimeSlime_Initialize(folder);
+
+    // Clock in/out pairs, every one a separate write as it is from the command line
+    double start = now_ms();
+    for (i = 0; i < AUTOTUNE_SESSIONS && status == TIMESLIME_OK; i++)
+    {
+        status = TimeSlime_ClockIn(TIMESLIME_TIME_NOW);
+        if (status == TIMESLIME_OK)
+            status = TimeSlime_ClockOut(TIMESLIME_TIME_NOW);
+    }
+    *write_ms = (now_ms() - start) / AUTOTUNE_SESSIONS;
+
+    start = now_ms();
+    for (i = 0; i < AUTOTUNE_REPORTS && status == TIMESLIME_OK; i++)
+    {
+        TIMESLIME_REPORT_t *report;
+        status = TimeSlime_GetReport((TIMESLIME_DATE_t){ 1970, 1, 1 }, (TIMESLIME_DATE_t){ 9999, 12, 31 }, &report);
+        if (status == TIMESLIME_OK)
+            TimeSlime_FreeReport(&report);
+    }
+    *report_ms = (now_ms() - start) / AUTOTUNE_REPORTS;
+
+    TimeSlime_Close();
+    remove_scratch_folder(folder);
+
+    return status == TIMESLIME_OK;
+}
+
+/**
+ * Removes a scratch folder and the time sheet files in it
+ */
+static void remove_scratch_folder(char *folder)
+{
+    char *suffixes[] = { "", "-wal", "-shm", "-journal" };
+    char file[PATH_MAX];
+    int i;
+
+    for (i = 0; i < (int)(sizeof(suffixes) / sizeof(suffixes[0])); i++)
+    {
+        sprintf(file, "%s%s%s%s", folder, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_DATABASE_FILE_NAME, suffixes[i]);
+        remove(file);
+    }
+    sprintf(file, "%s%s%s", folder, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_LOG_FILE_NAME);
+    remove(file);
+    sprintf(file, "%s%s%s", folder, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_STATUS_FILE_NAME);
+    remove(file);
+
+#ifndef _WIN32
+    // A process killed while writing the status file leaves its temporary file behind
+    glob_t matches;
+    size_t j;
+    sprintf(file, "%s%s%s.*.tmp", folder, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_STATUS_FILE_NAME);
+    if (glob(file, 0, NULL, &matches) == 0)
+    {
+        for (j = 0; j < matches.gl_pathc; j++)
+            remove(matches.gl_pathv[j]);
+        globfree(&matches);
+    }
+#endif
+
+    remove_directory(folder);
+}
+
+/**
+ * Kills a writer at random points under every storage profile, then reopens the time sheet and
+ * checks that everything the writer was told had succeeded is still there and nothing is broken
+ */
+static void perform_crashtest_action(char *base_folder)
+{
+#ifndef _WIN32
+    char *names[] = {
+        TIMESLIME_PROFILE_DURABLE,
+        TIMESLIME_PROFILE_BALANCED,
+        TIMESLIME_PROFILE_THROUGHPUT,
+        TIMESLIME_PROFILE_READMOSTLY
+    };
+    int number_of_profiles = sizeof(names) / sizeof(names[0]);
+    int acknowledged, lost, corrupt;
+    double ops_per_second;
+    double fastest = 0;
+    char *recommended = NULL;
+    TIMESLIME_SETTINGS_t settings;
+
+    char folder[PATH_MAX];
+    sprintf(folder, "%s%s%s%d", base_folder, TIMESLIME_FILE_PATH_SEPARATOR, CRASHTEST_FOLDER, (int)process_id());
+
+    srand((unsigned int)time(NULL) ^ (unsigned int)process_id());
+
+    log_info("Killing a writer %d times per profile...", CRASHTEST_ROUNDS);
+    printf("\t%-12s %12s %12s %8s %8s\n", "profile", "acknowledged", "ops/s", "lost", "corrupt");
+
+    int i;
+    for (i = 0; i < number_of_profiles; i++)
+    {
+        if (!crash_profile(folder, names[i], &acknowledged, &ops_per_second, &lost, &corrupt))
+        {
+            printf("Error: %s\n", TimeSlime_StatusCode(status));
+            return;
+        }
+        printf("\t%-12s %12d %12.0f %8d %8d\n", names[i], acknowledged, ops_per_second, lost, corrupt);
+
+        // Killing the process leaves the operating system's cache alone, so a profile that never
+        // syncs always survives here; it only differs from the others in what a power loss costs
+        if (TimeSlime_GetProfile(names[i], &settings) != TIMESLIME_OK || settings.Synchronous == 0)
+            continue;
+
+        if (lost == 0 && corrupt == 0 && ops_per_second > fastest)
+        {
+            fastest = ops_per_second;
+            recommended = names[i];
+        }
+    }
+
+    printf("\n");
+    log_warning("A killed process leaves the operating system's cache intact, so this does not cover power loss");
+    log_warning("Profiles that never sync to disk always survive it and are not recommended");
+    if (recommended != NULL)
+    {
+        log_info("Fastest profile that survived every crash: --%s=%s", PROFILE_OPTION, recommended);
+    }
+    else {
+        log_error("Every profile lost acknowledged writes or was left broken");
+    }
+#else
+    log_error("'%s' needs fork and is not supported on Windows", CRASHTEST_ACTION);
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * Runs the crash rounds of one profile in a fresh scratch folder, which is removed afterwards.
+ * Every write of a worker has its own slot, with a clock in minute and added hours no other write
+ * uses. The worker sends the slot and kind of every write that returned OK down a pipe, and each
+ * of those is looked for by itself once the time sheet is reopened. Returns 0 on error
+ */
+static int crash_profile(char *folder, char *profile, int *acknowledged, double *ops_per_second, int *lost, int *corrupt)
+{
+    double running_ms = 0;
+    int next = 0;
+    int ack;
+    int round;
+
+    *acknowledged = 0;
+    *ops_per_second = 0;
+    *lost = 0;
+    *corrupt = 0;
+
+    // Low 3 bits are the clock in, clock out and added hours acknowledged for a slot, the next 3 those found
+    unsigned char *marks = calloc(CRASHTEST_SLOTS, 1);
+    if (marks == NULL)
+    {
+        status = TIMESLIME_UNKOWN_ERROR;
+        return 0;
+    }
+
+    make_directory(folder);
+    fflush(stdout);
+
+    for (round = 0; round < CRASHTEST_ROUNDS; round++)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            status = TIMESLIME_UNKOWN_ERROR;
+            break;
+        }
+
+        double start = now_ms();
+        pid_t worker = fork();
+        if (worker < 0)
+        {
+            close(fds[0]);
+            close(fds[1]);
+            status = TIMESLIME_UNKOWN_ERROR;
+            break;
+        }
+
+        if (worker == 0)
+        {
+            int slot;
+
+            close(fds[0]);
+            if (TimeSlime_Configure(profile) != TIMESLIME_OK || TimeSlime_Initialize(folder) != TIMESLIME_OK)
+                _exit(1);
+
+            // The last worker may have been killed between clocking in and telling anyone, that session
+            // is at most a slot before this one so closing it here keeps it short
+            TimeSlime_ClockOut(crash_time(next, 0));
+
+            for (slot = next; slot < CRASHTEST_SLOTS; slot++)
+            {
+                if (TimeSlime_ClockIn(crash_time(slot, 0)) != TIMESLIME_OK)
+                    continue;
+
+                ack = slot * 4 + 1;
+                if (write(fds[1], &ack, sizeof(ack)) != sizeof(ack))
+                    _exit(1);
+
+                ack = slot * 4 + 2;
+                if (TimeSlime_ClockOut(crash_time(slot, 30)) == TIMESLIME_OK && write(fds[1], &ack, sizeof(ack)) != sizeof(ack))
+                    _exit(1);
+
+                ack = slot * 4 + 3;
+                if (TimeSlime_AddHours((float)(slot + 1), (TIMESLIME_DATE_t){ 2000, 1, 1 }) == TIMESLIME_OK && write(fds[1], &ack, sizeof(ack)) != sizeof(ack))
+                    _exit(1);
+            }
+
+            // Out of slots, wait to be killed
+            for (;;)
+                pause();
+        }
+
+        close(fds[1]);
+        sleep_ms(CRASHTEST_MIN_MS + rand() % (CRASHTEST_MAX_MS - CRASHTEST_MIN_MS));
+        kill(worker, SIGKILL);
+        waitpid(worker, NULL, 0);
+        running_ms += now_ms() - start;
+
+        while (read(fds[0], &ack, sizeof(ack)) == sizeof(ack))
+        {
+            marks[ack / 4] |= 1 << ((ack % 4) - 1);
+            (*acknowledged)++;
+
+            // Past whatever the worker was writing when it was killed
+            if (ack / 4 + 2 > next)
+                next = ack / 4 + 2;
+        }
+        close(fds[0]);
+    }
+
+    // Reopen after the last crash, a time sheet that will not open is broken
+    if (status == TIMESLIME_OK)
+    {
+        if (TimeSlime_Configure(profile) != TIMESLIME_OK || TimeSlime_Initialize(folder) != TIMESLIME_OK)
+            *corrupt = 1;
+        else {
+            TIMESLIME_VERIFY_t verify;
+            status = TimeSlime_IterateEntries(TIMESLIME_FILTER_ALL, mark_entry, marks);
+            if (status == TIMESLIME_OK)
+                status = TimeSlime_Verify(0, 0, count_damage, corrupt, &verify);
+            TimeSlime_Close();
+        }
+    }
+
+    // Every acknowledged write has to be found by itself, an extra unacknowledged one can not stand in for it
+    if (!*corrupt)
+    {
+        int slot;
+        for (slot = 0; slot < next && slot < CRASHTEST_SLOTS; slot++)
+        {
+            int missing = marks[slot] & ~(marks[slot] >> 3) & 7;
+            *lost += (missing & 1) + ((missing >> 1) & 1) + ((missing >> 2) & 1);
+        }
+    }
+
+    if (running_ms > 0)
+        *ops_per_second = *acknowledged * 1000.0 / running_ms;
+
+    free(marks);
+    remove_scratch_folder(folder);
+
+    return status == TIMESLIME_OK;
+}
+
+/**
+ * Clock time of a crash test slot, one minute per slot. Months are cut to 28 days so
+ * mark_entry can work a slot back out of the time without a calendar
+ */
+static TIMESLIME_DATETIME_t crash_time(int slot, int second)
+{
+    TIMESLIME_DATETIME_t time;
+
+    time.year = 2000 + slot / (12 * 28 * 1440);
+    time.month = 1 + (slot / (28 * 1440)) % 12;
+    time.day = 1 + (slot / 1440) % 28;
+    time.hour = (slot / 60) % 24;
+    time.minute = slot % 60;
+    time.second = second;
+
+    return time;
+}
+
+/**
+ * Marks the writes of crash_profile found in the time sheet, by the slot in the clock in time or added hours
+ */
+static int mark_entry(TIMESLIME_ENTRY_t *entry, void *marks)
+{
+    unsigned char *found = (unsigned char*)marks;
+    TIMESLIME_DATETIME_t time;
+    int slot = -1;
+
+    if (strcmp(entry->ClockInTime, "NULL") == 0)
+        slot = (int)entry->HoursAdded - 1;
+    else if (TimeSlime_ParseDateTime(entry->ClockInTime, &time) == TIMESLIME_OK)
+        slot = ((((time.year - 2000) * 12 + (time.month - 1)) * 28 + (time.day - 1)) * 24 + time.hour) * 60 + time.minute;
+
+    if (slot < 0 || slot >= CRASHTEST_SLOTS)
+        return 0;
+
+    if (strcmp(entry->ClockInTime, "NULL") == 0)
+        found[slot] |= 4 << 3;
+    else {
+        found[slot] |= 1 << 3;
+        if (strcmp(entry->ClockOutTime, "NULL") != 0)
+            found[slot] |= 2 << 3;
+    }
+
+    return 0;
+}
+
+/**
+ * Counts the entries verify found broken, every write of the crash test is unique so copies are damage too
+ */
+static void count_damage(int id, int problems, int repaired, void *damaged)
+{
+    if (problems)
+        (*(int*)damaged)++;
+}
+#endif
+
+/**
+ * Runs more and more writer processes against one time sheet at the same time. Each adds
+ * CONTENTION_WRITES hours and counts the ones that returned OK, then the entries are counted:
+ * every acknowledged write must be there, and nothing that failed, TIMESLIME_BUSY included
+ */
+static void perform_contention_action(char *base_folder)
+{
+#ifndef _WIN32
+    int writers[] = { 1, 2, 4, 8, 16 };
+    int number_of_rounds = sizeof(writers) / sizeof(writers[0]);
+    int acknowledged, busy, rows;
+    double writes_per_second;
+    int mismatched = 0;
+
+    char folder[PATH_MAX];
+    sprintf(folder, "%s%s%s%d", base_folder, TIMESLIME_FILE_PATH_SEPARATOR, CONTENTION_FOLDER, (int)process_id());
+
+    log_info("Adding %d hours from each writer at once...", CONTENTION_WRITES);
+    printf("\t%8s %12s %8s %12s %8s %8s\n", "writers", "acknowledged", "busy", "writes/s", "lost", "extra");
+
+    int i;
+    for (i = 0; i < number_of_rounds; i++)
+    {
+        if (!contention_round(folder, writers[i], &acknowledged, &busy, &writes_per_second, &rows))
+        {
+            printf("Error: %s\n", TimeSlime_StatusCode(status));
+            return;
+        }
+
+        printf("\t%8d %12d %8d %12.0f %8d %8d\n", writers[i], acknowledged, busy, writes_per_second,
+            (acknowledged > rows) ? acknowledged - rows : 0, (rows > acknowledged) ? rows - acknowledged : 0);
+        mismatched += (rows != acknowledged);
+    }
+
+    printf("\n");
+    if (mismatched == 0)
+    {
+        log_info("Every acknowledged write landed, and none of those that failed did");
+    }
+    else {
+        log_error("The time sheet does not match the acknowledged writes in %d of %d rounds", mismatched, number_of_rounds);
+    }
+#else
+    log_error("'%s' needs fork and is not supported on Windows", CONTENTION_ACTION);
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * Forks writers that all add hours to the time sheet in a fresh scratch folder, which is removed
+ * afterwards. Each writer sends its acknowledged and busy counts down a pipe when it is done,
+ * and rows is the number of entries found once they have all finished. Returns 0 on error
+ */
+static int contention_round(char *folder, int writers, int *acknowledged, int *busy, double *writes_per_second, int *rows)
+{
+    int counts[2];
+    int started;
+    int fds[2];
+
+    *acknowledged = 0;
+    *busy = 0;
+    *writes_per_second = 0;
+    *rows = 0;
+
+    // Tables are made up front, so the writers only race on the writes themselves
+    make_directory(folder);
+    status = TimeSlime_Initialize(folder);
+    if (status != TIMESLIME_OK)
+        return 0;
+    TimeSlime_Close();
+
+    if (pipe(fds) != 0)
+    {
+        status = TIMESLIME_UNKOWN_ERROR;
+        return 0;
+    }
+    fflush(stdout);
+
+    double start = now_ms();
+    for (started = 0; started < writers; started++)
+    {
+        pid_t writer = fork();
+        if (writer < 0)
+        {
+            status = TIMESLIME_UNKOWN_ERROR;
+            break;
+        }
+
+        if (writer == 0)
+        {
+            int write_number;
+            TIMESLIME_STATUS_t write_status;
+
+            close(fds[0]);
+            counts[0] = 0;
+            counts[1] = 0;
+            if (TimeSlime_Initialize(folder) != TIMESLIME_OK)
+                _exit(1);
+
+            for (write_number = 0; write_number < CONTENTION_WRITES; write_number++)
+            {
+                write_status = TimeSlime_AddHours(1, (TIMESLIME_DATE_t){ 2000, 1, 1 });
+                if (write_status == TIMESLIME_OK)
+                    counts[0]++;
+                else if (write_status == TIMESLIME_BUSY)
+                    counts[1]++;
+            }
+
+            TimeSlime_Close();
+            _exit(write(fds[1], counts, sizeof(counts)) != sizeof(counts));
+        }
+    }
+    close(fds[1]);
+
+    while (read(fds[0], counts, sizeof(counts)) == sizeof(counts))
+    {
+        *acknowledged += counts[0];
+        *busy += counts[1];
+    }
+    close(fds[0]);
+    while (started-- > 0)
+        wait(NULL);
+
+    double elapsed_ms = now_ms() - start;
+    if (elapsed_ms > 0)
+        *writes_per_second = *acknowledged * 1000.0 / elapsed_ms;
+
+    if (status == TIMESLIME_OK)
+        status = TimeSlime_Initialize(folder);
+    if (status == TIMESLIME_OK)
+    {
+        status = TimeSlime_IterateEntries(TIMESLIME_FILTER_ALL, count_entry, rows);
+        TimeSlime_Close();
+    }
+
+    remove_scratch_folder(folder);
+
+    return status == TIMESLIME_OK;
+}
+
+/**
+ * Counts the entries in the time sheet
+ */
+static int count_entry(TIMESLIME_ENTRY_t *entry, void *count)
+{
+    (*(int*)count)++;
+    return 0;
+}
+#endif
+
+/**
+ * Parses a mix of dates and date times, some of them invalid, with each parser in turn and prints
+ * how many million it parsed per second. sscanf reads the same strings without any checks, for reference
+ */
+static void perform_parsebench_action(void)
+{
+    const char *dates[] = { "2024-02-29", "2023/12/31", "1999-1-5", "2023-02-29", "2024-13-01", "20x4-01-01" };
+    const char *datetimes[] = { "2024-02-29 23:59:59", "2023/12/31T08:30", "1999-01-05 7:05:00", "2024-06-31 12:00:00", "2024-01-01 24:00", "2024-01-01 12:3" };
+    int number_of_dates = sizeof(dates) / sizeof(dates[0]);
+    int number_of_datetimes = sizeof(datetimes) / sizeof(datetimes[0]);
+    TIMESLIME_DATE_t date;
+    TIMESLIME_DATETIME_t datetime;
+    int year, month, day, hour, minute, second;
+    int valid;
+    int i;
+
+    log_info("Parsing %d strings with each parser...", PARSEBENCH_PARSES);
+    printf("\t%-24s %12s %10s\n", "parser", "million/s", "valid");
+
+    // Counting the valid results keeps the compiler from dropping the parses
+    double start = now_ms();
+    for (i = 0, valid = 0; i < PARSEBENCH_PARSES; i++)
+        valid += (TimeSlime_ParseDate(dates[i % number_of_dates], &date) == TIMESLIME_OK);
+    printf("\t%-24s %12.1f %10d\n", "TimeSlime_ParseDate", PARSEBENCH_PARSES / ((now_ms() - start) * 1000.0), valid);
+
+    start = now_ms();
+    for (i = 0, valid = 0; i < PARSEBENCH_PARSES; i++)
+        valid += (TimeSlime_ParseDateTime(datetimes[i % number_of_datetimes], &datetime) == TIMESLIME_OK);
+    printf("\t%-24s %12.1f %10d\n", "TimeSlime_ParseDateTime", PARSEBENCH_PARSES / ((now_ms() - start) * 1000.0), valid);
+
+    start = now_ms();
+    for (i = 0, valid = 0; i < PARSEBENCH_PARSES; i++)
+        valid += (sscanf(datetimes[i % number_of_datetimes], "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second) == 6);
+    printf("\t%-24s %12.1f %10d\n", "sscanf", PARSEBENCH_PARSES / ((now_ms() - start) * 1000.0), valid);
+}
+
+/**
+ * Wall clock in milliseconds, for timing the autotune workload
+ */
+static double now_ms(void)
+{
+#ifndef _WIN32
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#else
+    return (double)GetTickCount();
+#endif
+}
+
+
+/* Help Screen */
+void display_help(void)
+{
+    printf("Author: %s\n", AUTHOR);
+    printf("Version: %s\n", TIMESLIME_VERSION_STR);
+    printf("%s\n\n\n", DESCRIPTION);
+
+    printf("Usage:\n");
+    printf("\t%s [action] [arguments...]\n\n", PROGRAM_NAME);
+
+    printf("Actions:\n");
+
+    printf("\t%s\t %s\n", ADD_ACTION, ADD_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", CLOCK_ACTION, CLOCK_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", REPORT_ACTION, REPORT_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", LIST_ACTION, LIST_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", AUDIT_ACTION, AUDIT_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", ANALYZE_ACTION, ANALYZE_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", STATUS_ACTION, STATUS_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", COMPACT_ACTION, COMPACT_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", VERIFY_ACTION, VERIFY_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", PAYROLL_ACTION, PAYROLL_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", CHANGES_ACTION, CHANGES_ACTION_DESCRIPTION);
+    printf("\t%s\t %s\n", SYNC_ACTION, SYNC_ACTION_DESCRIPTION);
+    printf("\t%s %s\n", AUTOTUNE_ACTION, AUTOTUNE_ACTION_DESCRIPTION);
+    printf("\t%s %s\n", BENCHMARK_ACTION, BENCHMARK_ACTION_DESCRIPTION);
+    printf("\t%s %s\n", CRASHTEST_ACTION, CRASHTEST_ACTION_DESCRIPTION);
+    printf("\t%s %s\n", CONTENTION_ACTION, CONTENTION_ACTION_DESCRIPTION);
+    printf("\t%s %s\n", PARSEBENCH_ACTION, PARSEBENCH_ACTION_DESCRIPTION);
+    printf("\n");
+
+    printf("\t%s\t %s\n\n", HELP_ACTION, HELP_ACTION_DESCRIPTION);
+
+    printf("Options:\n");
+    printf("\t--%s=(sqlite|log)\t Storage backend to use, defaults to sqlite\n", BACKEND_OPTION);
+    printf("\t--%s=(durable|balanced|throughput|readmostly)\t Storage tuning profile, see '%s'\n", PROFILE_OPTION, AUTOTUNE_ACTION);
+    printf("\t--%s=PATTERN\t Include other time sheet files matching PATTERN in reports\n\n", ATTACH_OPTION);
+
+    printf("\n%s Action Usage:\n", ADD_ACTION);
+    printf("\t%s add (+|-)[0-9] [--%s=NAME] [--%s=KEY]\n", PROGRAM_NAME, PROJECT_OPTION, KEY_OPTION);
+    printf("\t%s add (+|-)[0-9] YYYY/MM/DD [--%s=NAME] [--%s=KEY]\n\n", PROGRAM_NAME, PROJECT_OPTION, KEY_OPTION);
+
+    printf("%s Action Usage:\n", CLOCK_ACTION);
+    printf("\t%s clock in [--%s=NAME] [--%s=KEY]\n", PROGRAM_NAME, PROJECT_OPTION, KEY_OPTION);
+    printf("\t%s clock out [--%s=KEY]\n", PROGRAM_NAME, KEY_OPTION);
+    printf("\t%s clock in|out JOB\n\n", PROGRAM_NAME);
+
+    printf("%s Action Usage:\n", REPORT_ACTION);
+    printf("\t%s report YYYY/MM/DDD YYYY/MM/DDD [--%s]\n", PROGRAM_NAME, WATCH_OPTION);
+    printf("\t%s report YYYY/MM/DDD YYYY/MM/DDD --%s\n", PROGRAM_NAME, TOTAL_OPTION);
+    printf("\t%s report YYYY/MM/DDD YYYY/MM/DDD --%s=%s\n\n", PROGRAM_NAME, BY_OPTION, BY_PROJECT);
+
+    printf("%s Action Usage:\n", LIST_ACTION);
+    printf("\t%s list [YYYY/MM/DDD [YYYY/MM/DDD]] [--kind=clock|hours|all] [--state=open|closed|all] [--after=ID] [--limit=N]\n\n", PROGRAM_NAME);
+
+    printf("%s Action Usage:\n", AUDIT_ACTION);
+    printf("\t%s audit overlaps YYYY/MM/DDD YYYY/MM/DDD\n\n", PROGRAM_NAME);
+
+    printf("%s Action Usage:\n", ANALYZE_ACTION);
+    printf("\t%s analyze [YYYY/MM/DDD [YYYY/MM/DDD]]\n\n", PROGRAM_NAME);
+
+    printf("%s Action Usage:\n", COMPACT_ACTION);
+    printf("\t%s compact [MONTHS]\n", PROGRAM_NAME);
+    printf("\t%s compact --%s\n\n", PROGRAM_NAME, CONVERT_OPTION);
+
+    printf("%s Action Usage:\n", VERIFY_ACTION);
+    printf("\t%s verify [--%s] [--%s=N]\n\n", PROGRAM_NAME, REPAIR_OPTION, LIMIT_OPTION);
+
+    printf("%s Action Usage:\n", PAYROLL_ACTION);
+    printf("\t%s payroll [YYYY/MM/DDD [YYYY/MM/DDD]] [--%s=MINUTES] [--%s=HOURS] [--%s=HOURS] [--%s=MINUTES --%s=HOURS] [--%s=0-6]\n",
+        PROGRAM_NAME, ROUND_OPTION, DAILY_OPTION, WEEKLY_OPTION, BREAK_OPTION, BREAK_AFTER_OPTION, WEEK_START_OPTION);
+    printf("\n");
+
+    printf("%s Action Usage:\n", CHANGES_ACTION);
+    printf("\t%s changes [TOKEN] [--%s=N]\n\n", PROGRAM_NAME, LIMIT_OPTION);
+
+    printf("%s Action Usage:\n", SYNC_ACTION);
+    printf("\t%s sync export FILE [--%s]\n", PROGRAM_NAME, FULL_OPTION);
+    printf("\t%s sync import FILE\n", PROGRAM_NAME);
 
     printf("\n");
 }
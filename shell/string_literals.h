@@ -15,6 +15,48 @@
 #define REPORT_ACTION   "report"
 #define REPORT_ACTION_DESCRIPTION "Show all hours worked between two date ranges"
 
+#define LIST_ACTION     "list"
+#define LIST_ACTION_DESCRIPTION "List time sheet entries one page at a time"
+
+#define AUDIT_ACTION    "audit"
+#define AUDIT_ACTION_DESCRIPTION "Check the time sheet for problems, such as overlapping clock sessions"
+
+#define STATUS_ACTION   "status"
+#define STATUS_ACTION_DESCRIPTION "Show if you are clocked in and the hours worked today, fast enough for a shell prompt"
+
+#define ANALYZE_ACTION  "analyze"
+#define ANALYZE_ACTION_DESCRIPTION "Show work patterns: hours heatmap, rolling averages, session lengths and breaks"
+
+#define COMPACT_ACTION  "compact"
+#define COMPACT_ACTION_DESCRIPTION "Fold clock sessions older than the retention period into daily totals and reclaim the space"
+
+#define VERIFY_ACTION   "verify"
+#define VERIFY_ACTION_DESCRIPTION "Check the time sheet for broken entries, a chunk at a time, and optionally repair them"
+
+#define PAYROLL_ACTION  "payroll"
+#define PAYROLL_ACTION_DESCRIPTION "Apply rounding, break and overtime rules to show paid hours per day and week"
+
+#define CHANGES_ACTION  "changes"
+#define CHANGES_ACTION_DESCRIPTION "List the entries changed since a token from an earlier run, for syncing elsewhere"
+
+#define SYNC_ACTION     "sync"
+#define SYNC_ACTION_DESCRIPTION "Export the changes made here to a file, or import one from another machine"
+
+#define AUTOTUNE_ACTION "autotune"
+#define AUTOTUNE_ACTION_DESCRIPTION "Benchmark each storage profile on this machine and recommend one"
+
+#define BENCHMARK_ACTION "benchmark"
+#define BENCHMARK_ACTION_DESCRIPTION "Time the sqlite and log storage backends side by side under each storage profile"
+
+#define CRASHTEST_ACTION "crashtest"
+#define CRASHTEST_ACTION_DESCRIPTION "Kill writers at random under each storage profile and check nothing acknowledged was lost"
+
+#define CONTENTION_ACTION "contention"
+#define CONTENTION_ACTION_DESCRIPTION "Run writers in several processes against one time sheet and check every acknowledged write landed"
+
+#define PARSEBENCH_ACTION "parsebench"
+#define PARSEBENCH_ACTION_DESCRIPTION "Time the date and date time parsers on this machine"
+
 #define HELP_ACTION     "help"
 #define HELP_ACTION_DESCRIPTION "Receive information on how to use the program or an action"
 
@@ -25,6 +67,61 @@
 #define CLOCK_IN    "in"
 #define CLOCK_OUT   "out"
 
+#define SYNC_EXPORT "export"
+#define SYNC_IMPORT "import"
+
+#define AUDIT_OVERLAPS  "overlaps"
+
+/* Options */
+#define BACKEND_OPTION  "backend"
+#define PROFILE_OPTION  "profile"
+#define ATTACH_OPTION   "attach"
+#define WATCH_OPTION    "watch"
+#define KIND_OPTION     "kind"
+#define STATE_OPTION    "state"
+#define AFTER_OPTION    "after"
+#define LIMIT_OPTION    "limit"
+#define REPAIR_OPTION   "repair"
+#define PROJECT_OPTION  "project"
+#define KEY_OPTION      "key"
+#define FULL_OPTION     "full"
+#define TOTAL_OPTION    "total"
+#define CONVERT_OPTION  "convert"
+#define BY_OPTION       "by"
+#define ROUND_OPTION    "round"
+#define DAILY_OPTION    "daily"
+#define WEEKLY_OPTION   "weekly"
+#define BREAK_OPTION    "break"
+#define BREAK_AFTER_OPTION  "break-after"
+#define WEEK_START_OPTION   "week-start"
+
+#define KIND_CLOCK      "clock"
+#define KIND_HOURS      "hours"
+#define STATE_OPEN      "open"
+#define STATE_CLOSED    "closed"
+#define ALL             "all"
+#define BY_PROJECT      "project"
+
+#define WATCH_INTERVAL_MS   1000
+
+#define AUTOTUNE_FOLDER     "autotune-"
+#define AUTOTUNE_SESSIONS   200
+#define AUTOTUNE_REPORTS    50
+#define AUTOTUNE_TARGET_MS  2.0     /* Slowest clock in/out a person will not notice */
+
+#define BENCHMARK_FOLDER    "benchmark-"
+
+#define CRASHTEST_FOLDER    "crashtest-"
+#define CRASHTEST_ROUNDS    20      /* Workers killed per profile */
+#define CRASHTEST_MIN_MS    20      /* Random time a worker runs before it is killed */
+#define CRASHTEST_MAX_MS    200
+#define CRASHTEST_SLOTS     2000000 /* Writes a profile can make, each with its own clock in minute and added hours */
+
+#define CONTENTION_FOLDER   "contention-"
+#define CONTENTION_WRITES   200     /* Added hours entries each writer makes */
+
+#define PARSEBENCH_PARSES   10000000    /* Strings parsed by each parser */
+
 
 
 /* About */
@@ -5,6 +5,38 @@
  */
 #include "timeslime.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <windows.h>
+#define _TIMESLIME_SLEEP_MS(ms)             Sleep(ms)
+#define _TIMESLIME_REPLACE_FILE(from, to)   (MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1)
+#define _TIMESLIME_FILENO(file)             _fileno(file)
+#define _TIMESLIME_FSYNC(fd)                _commit(fd)
+#define _TIMESLIME_FTRUNCATE(fd, size)      _chsize(fd, size)
+#define _TIMESLIME_PROCESS_ID()             _getpid()
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#define _TIMESLIME_FILENO(file)             fileno(file)
+#define _TIMESLIME_FSYNC(fd)                fsync(fd)
+#define _TIMESLIME_FTRUNCATE(fd, size)      ftruncate(fd, size)
+#define _TIMESLIME_SLEEP_MS(ms)             usleep((ms) * 1000)
+#define _TIMESLIME_REPLACE_FILE(from, to)   rename(from, to)
+#define _TIMESLIME_PROCESS_ID()             getpid()
+#endif
+
+#define _TIMESLIME_SECONDS_PER_DAY          86400
+
+/* Status file line: version, open session ID (0 for none), clock in seconds, day and closed hours on that day */
+#define _TIMESLIME_STATUS_VERSION           1
+#define _TIMESLIME_STATUS_FORMAT            "timeslime-status %d %d %lld %lld %lf\n"
+#define _TIMESLIME_FLOOR_DIV(a, b)          (((a) >= 0) ? ((a) / (b)) : -((-(a) + (b) - 1) / (b)))
+
 /* Row result for internal library use */
 struct TIMESLIME_INT_ROW_STRUCT {
     int ID;
@@ -14,70 +46,524 @@ struct TIMESLIME_INT_ROW_STRUCT {
     char ClockInTime[TIMESLIME_DATETIME_STR_LENGTH];
     char ClockOutTime[TIMESLIME_DATETIME_STR_LENGTH];
     char TimeSheetDate[TIMESLIME_DATETIME_STR_LENGTH];
+    int ProjectID;      /* 0 for no project */
+    int Job;            /* 1 for the session of a job timer */
 };
 typedef struct TIMESLIME_INT_ROW_STRUCT TIMESLIME_INTERNAL_ROW_t;
 
+/* Callback and user data while iterating over SQLITE results */
+struct TIMESLIME_ITERATOR_STRUCT {
+    TIMESLIME_ENTRY_CALLBACK_t Callback;
+    void *UserData;
+};
+typedef struct TIMESLIME_ITERATOR_STRUCT TIMESLIME_ITERATOR_t;
+
+/* Log backend record types */
+#define _TIMESLIME_LOG_MAGIC        0x534C5354  /* "TSLS" */
+#define _TIMESLIME_LOG_HOURS        1
+#define _TIMESLIME_LOG_CLOCK_IN     2
+#define _TIMESLIME_LOG_CLOCK_OUT    3
+
+/* Fixed size record in the log backend file */
+struct TIMESLIME_LOG_RECORD_STRUCT {
+    uint32_t Magic;
+    uint32_t Type;
+    int32_t ID;         /* A clock out carries the ID of its clock in */
+    float Hours;
+    int64_t Time;       /* Seconds since 1970-01-01 00:00:00 in local time */
+    uint32_t Reserved;
+    uint32_t Checksum;
+};
+typedef struct TIMESLIME_LOG_RECORD_STRUCT TIMESLIME_LOG_RECORD_t;
+
+/* Sparse per day index for the log backend, only days with entries are kept */
+struct TIMESLIME_LOG_DAY_STRUCT {
+    int64_t Day;        /* Days since 1970-01-01 */
+    double Hours;
+    long FirstOffset;   /* Offset of the first record in the log that belongs to this day */
+};
+typedef struct TIMESLIME_LOG_DAY_STRUCT TIMESLIME_LOG_DAY_t;
+
+
+/* Days in each month of a common year, February gets a leap day in _TimeSlime_DaysInMonth */
+static const unsigned char days_in_month[13] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+
+/* Running state for TimeSlime_Analyze, the same size however many entries are read */
+#define _TIMESLIME_ANALYSIS_BUCKETS         (24 * 60 + 1)   /* One per minute of session length, the last for a day or more */
+#define _TIMESLIME_ANALYSIS_WINDOW          30
+
+struct TIMESLIME_ANALYZER_STRUCT {
+    TIMESLIME_ANALYSIS_t *Out;
+    int64_t Day;                                        /* Day being summed, days since 1970-01-01 */
+    double DayHours;
+    int64_t WindowDays[_TIMESLIME_ANALYSIS_WINDOW];     /* Totals of the latest days, at day % window */
+    double WindowHours[_TIMESLIME_ANALYSIS_WINDOW];
+    int64_t LastClockOut;                               /* Seconds, latest end of a session so far */
+    double GapHours;
+    int SessionMinutes[_TIMESLIME_ANALYSIS_BUCKETS];
+};
+typedef struct TIMESLIME_ANALYZER_STRUCT TIMESLIME_ANALYZER_t;
+
+/* Running state for TimeSlime_Payroll, all in whole minutes so nothing drifts */
+struct TIMESLIME_PAYROLL_STATE_STRUCT {
+    TIMESLIME_PAYROLL_RULES_t Rules;
+    TIMESLIME_PAYROLL_CALLBACK_t Callback;
+    void *UserData;
+    int64_t Day;                /* Day being summed, days since 1970-01-01 */
+    int64_t DayWorked;
+    int64_t Week;               /* First day of the week being summed */
+    int64_t Worked[3];          /* Day, week and total, indexed by TIMESLIME_PAYROLL_* */
+    int64_t Break[3];
+    int64_t Regular[3];
+    int64_t Overtime[3];
+};
+typedef struct TIMESLIME_PAYROLL_STATE_STRUCT TIMESLIME_PAYROLL_STATE_t;
+
+/* Hours one entry adds to a watched report, Day is counted from the start of the report */
+struct TIMESLIME_WATCH_ENTRY_STRUCT {
+    int ID;
+    int Day;
+    float Hours;
+};
+typedef struct TIMESLIME_WATCH_ENTRY_STRUCT TIMESLIME_WATCH_ENTRY_t;
+
+/* Watched report, the per day totals are updated in place from the entries that changed */
+struct TIMESLIME_WATCH_STRUCT {
+    TIMESLIME_DATE_t Start;
+    TIMESLIME_DATE_t End;
+    int64_t StartDay;
+    int NumberOfDays;
+    double *DayHours;
+    int *DayEntries;
+    TIMESLIME_WATCH_ENTRY_t *Entries;   /* Entries counted in the report, by ID */
+    int NumberOfEntries;
+    int EntriesSize;
+    int LastID;                         /* Largest ID seen, newer entries are inserts */
+    char LastUpdate[TIMESLIME_DATETIME_STR_LENGTH];     /* Entries updated since are read again */
+    int DataVersion;
+    int TotalChanges;
+    TIMESLIME_REPORT_CALLBACK_t Callback;
+    void *UserData;
+    TIMESLIME_REPORT_t *Report;
+};
+
+/* One chunk of entries read by TimeSlime_Verify */
+struct TIMESLIME_VERIFY_CHUNK_STRUCT {
+    int NumberOfEntries;
+    int IDs[TIMESLIME_VERIFY_CHUNK];
+    int Problems[TIMESLIME_VERIFY_CHUNK];   /* TIMESLIME_PROBLEM_* flags */
+};
+typedef struct TIMESLIME_VERIFY_CHUNK_STRUCT TIMESLIME_VERIFY_CHUNK_t;
+
+/* One change read from a sync changeset */
+struct TIMESLIME_SYNC_RECORD_STRUCT {
+    int Deleted;
+    int Origin;                 /* Machine the entry was first made on */
+    long long OriginID;         /* ID of the entry on that machine */
+    long long HoursMantissa;    /* HoursAdded is exactly HoursMantissa / 2^HoursShift */
+    int HoursShift;
+    int HasDate;
+    long long Days;             /* HoursAddedDate, days since 1970-01-01 */
+    int HasClockIn;
+    long long ClockIn;          /* Seconds since 1970-01-01 */
+    int HasClockOut;
+    long long ClockOut;
+    int Job;
+    long long LastUpdate;       /* UTC seconds since 1970-01-01 */
+    char Project[TIMESLIME_PROJECT_STR_LENGTH];
+};
+typedef struct TIMESLIME_SYNC_RECORD_STRUCT TIMESLIME_SYNC_RECORD_t;
+
+/* Changeset being written by TimeSlime_SyncExport */
+struct TIMESLIME_SYNC_WRITER_STRUCT {
+    FILE *File;
+    int Machine;                /* This time sheet, its own entries are written without an origin */
+    TIMESLIME_SYNC_t *Out;
+};
+typedef struct TIMESLIME_SYNC_WRITER_STRUCT TIMESLIME_SYNC_WRITER_t;
+
+/* Result of a keyed request whose key was not seen before */
+#define _TIMESLIME_KEY_NEW                  -1
+
+/* Problems a repair can fix without guessing */
+#define _TIMESLIME_REPAIRABLE_PROBLEMS      (TIMESLIME_PROBLEM_OPEN | TIMESLIME_PROBLEM_NEGATIVE | TIMESLIME_PROBLEM_MIXED | TIMESLIME_PROBLEM_DUPLICATE)
+
+/* Sync changeset layout: magic, version and machine, then one record per change
+   starting with these flags, then the end marker and the number of records */
+#define _TIMESLIME_SYNC_MAGIC               "TSCS"
+#define _TIMESLIME_SYNC_VERSION             2
+#define _TIMESLIME_SYNC_MAX_SHIFT           124 /* Two exact divisions by at most 2^62 */
+#define _TIMESLIME_SYNC_DELETED             1
+#define _TIMESLIME_SYNC_FOREIGN             2   /* Origin follows, otherwise the entry was made by the sender */
+#define _TIMESLIME_SYNC_HOURS_DATE          4
+#define _TIMESLIME_SYNC_CLOCK_IN            8
+#define _TIMESLIME_SYNC_CLOCK_OUT           16  /* Seconds after clocking in when that is set */
+#define _TIMESLIME_SYNC_PROJECT             32
+#define _TIMESLIME_SYNC_JOB                 64  /* Session of a job timer */
+#define _TIMESLIME_SYNC_END                 0xFF
+
+/* Operations an async request can run */
+#define _TIMESLIME_ASYNC_ADD_HOURS          1
+#define _TIMESLIME_ASYNC_CLOCK_IN           2
+#define _TIMESLIME_ASYNC_CLOCK_OUT          3
+#define _TIMESLIME_ASYNC_REPORT             4
+
+/* Request queued for the async worker, it moves to the finished list once run */
+struct TIMESLIME_ASYNC_REQUEST_STRUCT {
+    int Operation;
+    float Hours;
+    TIMESLIME_DATE_t Start;     /* Date of added hours, or start of a report */
+    TIMESLIME_DATE_t End;
+    TIMESLIME_DATETIME_t Time;
+    TIMESLIME_ASYNC_CALLBACK_t Callback;
+    void *UserData;
+    TIMESLIME_STATUS_t Status;
+    void *Result;
+    struct TIMESLIME_ASYNC_REQUEST_STRUCT *Next;
+};
+typedef struct TIMESLIME_ASYNC_REQUEST_STRUCT TIMESLIME_ASYNC_REQUEST_t;
+
+/* Database file attached for federated reports, with the span of dates it holds */
+struct TIMESLIME_ATTACHED_STRUCT {
+    char Schema[16];
+    int FirstDay;   /* Days since 1970-01-01 */
+    int LastDay;
+};
+typedef struct TIMESLIME_ATTACHED_STRUCT TIMESLIME_ATTACHED_t;
+
+/* Storage tuning profiles, see TIMESLIME_SETTINGS_t */
+struct TIMESLIME_PROFILE_STRUCT {
+    char *Name;
+    TIMESLIME_SETTINGS_t Settings;
+};
+static const struct TIMESLIME_PROFILE_STRUCT profiles[] = {
+    { TIMESLIME_PROFILE_DURABLE,    { "DELETE", 2,                   0,  -2000,  4096, 0,    1,    0 } },
+    { TIMESLIME_PROFILE_BALANCED,   { "WAL",    1,    64 * 1024 * 1024,  -8000,  4096, 2,   32, 1000 } },
+    { TIMESLIME_PROFILE_THROUGHPUT, { "WAL",    0,   256 * 1024 * 1024, -32000,  8192, 2, 1024, 4000 } },
+    { TIMESLIME_PROFILE_READMOSTLY, { "WAL",    1, 1024LL * 1024 * 1024, -65536, 8192, 2,   32, 1000 } }
+};
+
 
 /* Variables */
 static sqlite3 *db;
 static char *db_error;
 static char *database_file_path;
+static char *status_file_path;
 static TIMESLIME_INTERNAL_ROW_t **database_results;
 static int number_of_results;
 static int result_array_size;
 static int is_initialized;
+static TIMESLIME_ATTACHED_t attached[TIMESLIME_MAX_ATTACHED];
+static int number_of_attached;
+static TIMESLIME_SETTINGS_t settings;
+static int has_settings;
+static int entry_project_id;    /* Project of the entry being added, 0 for none */
+
+#ifndef _WIN32
+static pthread_t async_thread;
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_wake = PTHREAD_COND_INITIALIZER;
+static TIMESLIME_ASYNC_REQUEST_t *async_queue;      /* Waiting to run, oldest first */
+static TIMESLIME_ASYNC_REQUEST_t *async_queue_last;
+static TIMESLIME_ASYNC_REQUEST_t *async_finished;   /* Waiting for their callbacks, oldest first */
+static TIMESLIME_ASYNC_REQUEST_t *async_finished_last;
+static int async_pipe[2] = { -1, -1 };              /* A byte is written for every finished request */
+static int async_running;
+static int async_stopping;
+
+static pthread_t checkpoint_thread;
+static pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t checkpoint_wake = PTHREAD_COND_INITIALIZER;
+static TIMESLIME_CHECKPOINT_STATS_t checkpoint_stats;
+static int checkpoint_threshold;        /* CheckpointPages in use */
+static int checkpoint_wal_pages;        /* Pages in the WAL after the last commit */
+static int checkpoint_done_pages;       /* Of those, pages already checkpointed */
+static double checkpoint_last_write;    /* Monotonic milliseconds */
+static int checkpoint_running;
+static int checkpoint_stopping;
+#endif
+
+static FILE *log_file;
+static char *log_file_path;
+static TIMESLIME_LOG_DAY_t *log_days;
+static int log_number_of_days;
+static int log_days_size;
+static int log_next_id;
+static int log_open_id;         /* 0 when not clocked in */
+static int64_t log_open_time;
+static long log_open_offset;
+static long log_end_offset;
+static int log_unsynced;
+static int log_lock_depth;      /* Lock on the log file is held while above 0 */
+static int log_sync_batch = TIMESLIME_LOG_SYNC_BATCH;
+static time_t log_last_sync;
 
 /* Functions */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_Open(char directory_for_database[]);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_Close(void);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_AddHours(float hours, TIMESLIME_DATE_t date);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_ClockIn(TIMESLIME_DATETIME_t time);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_ClockOut(TIMESLIME_DATETIME_t time);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_GetOpenSession(TIMESLIME_ENTRY_t *out, int *found);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out);
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_Iterate(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata);
+
+static TIMESLIME_STATUS_t _TimeSlime_Log_Open(char directory[]);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Close(void);
+static TIMESLIME_STATUS_t _TimeSlime_Log_AddHours(float hours, TIMESLIME_DATE_t date);
+static TIMESLIME_STATUS_t _TimeSlime_Log_ClockIn(TIMESLIME_DATETIME_t time);
+static TIMESLIME_STATUS_t _TimeSlime_Log_ClockOut(TIMESLIME_DATETIME_t time);
+static TIMESLIME_STATUS_t _TimeSlime_Log_GetOpenSession(TIMESLIME_ENTRY_t *out, int *found);
+static TIMESLIME_STATUS_t _TimeSlime_Log_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Iterate(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Append(TIMESLIME_LOG_RECORD_t *record);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Begin(void);
+static TIMESLIME_STATUS_t _TimeSlime_Log_End(TIMESLIME_STATUS_t status);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Replay(void);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Sync(void);
+static TIMESLIME_STATUS_t _TimeSlime_Log_Apply(TIMESLIME_LOG_RECORD_t *record, long offset);
+static int _TimeSlime_Log_FindDay(int64_t day);
+static TIMESLIME_LOG_DAY_t* _TimeSlime_Log_GetDay(int64_t day);
+static int _TimeSlime_Log_Matches(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_t *entry, int64_t day, int64_t startDay, int64_t endDay);
+static void _TimeSlime_Log_ToEntry(int id, int isHours, int64_t clockIn, int64_t clockOut, float hours, TIMESLIME_ENTRY_t *entry);
+static uint32_t _TimeSlime_Log_Checksum(TIMESLIME_LOG_RECORD_t *record);
+
+static TIMESLIME_STATUS_t _TimeSlime_ProjectID(char *project, int *out);
+static TIMESLIME_STATUS_t _TimeSlime_Keyed_Begin(char *key, int *nested, TIMESLIME_STATUS_t *original);
+static TIMESLIME_STATUS_t _TimeSlime_Keyed_End(char *key, int nested, TIMESLIME_STATUS_t result);
+static TIMESLIME_STATUS_t _TimeSlime_BeginWrite(int *nested);
+static TIMESLIME_STATUS_t _TimeSlime_EndWrite(int nested, TIMESLIME_STATUS_t status);
+static TIMESLIME_ASYNC_REQUEST_t* _TimeSlime_Async_New(int operation, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata);
+static TIMESLIME_STATUS_t _TimeSlime_Async_Submit(TIMESLIME_ASYNC_REQUEST_t *request);
+static void _TimeSlime_Async_Run(TIMESLIME_ASYNC_REQUEST_t *request);
+#ifndef _WIN32
+static void* _TimeSlime_Async_Worker(void *ignoreMe);
+static void* _TimeSlime_Checkpoint_Worker(void *ignoreMe);
+static int _TimeSlime_Checkpoint_WalHook(void *ignoreMe, sqlite3 *conn, const char *schema, int pages);
+static double _TimeSlime_MonotonicMs(void);
+#endif
+static void _TimeSlime_Checkpoint_Start(void);
+static void _TimeSlime_Checkpoint_Stop(void);
+static TIMESLIME_STATUS_t _TimeSlime_CompactChunk(int64_t startDay, int64_t endDay, TIMESLIME_COMPACTION_t *out);
+static TIMESLIME_STATUS_t _TimeSlime_DatabaseSize(long long *out);
+static TIMESLIME_STATUS_t _TimeSlime_VerifyChunk(int cursor, int limit, TIMESLIME_VERIFY_CHUNK_t *out);
+static TIMESLIME_STATUS_t _TimeSlime_RepairEntry(int id, int problems);
+static TIMESLIME_STATUS_t _TimeSlime_Sync_Read(FILE *file, int flags, int sender, TIMESLIME_SYNC_RECORD_t *out);
+static TIMESLIME_STATUS_t _TimeSlime_Sync_Apply(TIMESLIME_SYNC_RECORD_t *record, int machine, TIMESLIME_SYNC_t *out);
+static void _TimeSlime_Sync_PutVarint(FILE *file, uint64_t value);
+static void _TimeSlime_Sync_PutSigned(FILE *file, int64_t value);
+static int _TimeSlime_Sync_GetVarint(FILE *file, uint64_t *out);
+static int _TimeSlime_Sync_GetSigned(FILE *file, long long *out);
+static void _TimeSlime_Sync_SplitHours(double hours, long long *mantissa, int *shift);
+static TIMESLIME_STATUS_t _TimeSlime_GetState(char *name, int *out);
+static TIMESLIME_STATUS_t _TimeSlime_SetState(char *name, int value);
+static TIMESLIME_STATUS_t _TimeSlime_Watch_Rebuild(TIMESLIME_WATCH_t *watch);
+static TIMESLIME_STATUS_t _TimeSlime_Watch_Apply(TIMESLIME_WATCH_t *watch);
+static TIMESLIME_STATUS_t _TimeSlime_Watch_Version(TIMESLIME_WATCH_t *watch, int *changed);
+static void _TimeSlime_Watch_Set(TIMESLIME_WATCH_t *watch, int id, int day, float hours);
+static void _TimeSlime_Watch_Report(TIMESLIME_WATCH_t *watch);
+static char* _TimeSlime_StatusFilePath(char directory[]);
+static void _TimeSlime_WriteStatusFile(void);
 static TIMESLIME_STATUS_t _TimeSlime_CreateTables(void);
+static TIMESLIME_STATUS_t _TimeSlime_ApplySettings(void);
+static TIMESLIME_STATUS_t _TimeSlime_MigrateTables(void);
+static TIMESLIME_STATUS_t _TimeSlime_MigrateStep(int version, TIMESLIME_STATUS_t (*step)(void));
+static TIMESLIME_STATUS_t _TimeSlime_CreateIntervalIndex(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateEntryDateIndexes(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateUpdateTimeIndex(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateStateTable(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateProjects(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateChangeFeed(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateRequestKeys(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateOpenJobIndex(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateSyncLog(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateTotals(void);
+static TIMESLIME_STATUS_t _TimeSlime_CreateJobColumn(void);
 static TIMESLIME_STATUS_t _TimeSlime_InsertEntry(TIMESLIME_INTERNAL_ROW_t *row);
-static TIMESLIME_STATUS_t _TimeSlime_UpdateEntry(TIMESLIME_INTERNAL_ROW_t *row);
 static TIMESLIME_STATUS_t _TimeSlime_SelectEntries(int minID, char *whereClause);
+static int _TimeSlime_BuildReportSource(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, char *out);
 static TIMESLIME_STATUS_t _TimeSlime_ExecuteQuery(char *sql, int useCallback);
+static TIMESLIME_STATUS_t _TimeSlime_ExecuteChange(char *sql, int *affected);
+static TIMESLIME_STATUS_t _TimeSlime_QueryInt(char *sql, int *out);
+static TIMESLIME_STATUS_t _TimeSlime_QueryInt64(char *sql, long long *out);
+static TIMESLIME_STATUS_t _TimeSlime_SqliteStatus(int rc);
+static int _TimeSlime_BusyHandler(void *ignoreMe, int attempts);
+static TIMESLIME_STATUS_t _TimeSlime_BuildEntries(TIMESLIME_ENTRIES_t **out);
+static TIMESLIME_STATUS_t _TimeSlime_FilterToSql(TIMESLIME_FILTER_t filter, char *out);
 static TIMESLIME_STATUS_t _TimeSlime_VerifyTimestamp(TIMESLIME_DATETIME_t time);
 static TIMESLIME_STATUS_t _TimeSlime_VerifyDate(TIMESLIME_DATE_t date);
 
 static int _TIMESLIME_SQLITE_CALLBACK_WRAPPER(void *ignoreMe, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_INT_CALLBACK(void *out, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_INT64_CALLBACK(void *out, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_ENTRY_CALLBACK(void *iterator, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_ANALYZE_CALLBACK(void *analyzer, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_VERIFY_CALLBACK(void *chunk, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_PROJECT_CALLBACK(void *report, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_DENSE_CALLBACK(void *report, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_PAYROLL_CALLBACK(void *payroll, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_CHANGE_CALLBACK(void *changes, int numColumns, char **columns, char **columnNames);
+static int _TIMESLIME_SQLITE_SYNC_CALLBACK(void *writer, int numColumns, char **columns, char **columnNames);
+
+static void _TimeSlime_Analyze_Session(TIMESLIME_ANALYZER_t *analyzer, int64_t clockIn, int64_t clockOut, char **columns);
+static void _TimeSlime_Analyze_EndDay(TIMESLIME_ANALYZER_t *analyzer);
+static double _TimeSlime_Analyze_Average(TIMESLIME_ANALYZER_t *analyzer, int64_t endDay, int days);
+static float _TimeSlime_Analyze_Quantile(TIMESLIME_ANALYZER_t *analyzer, double quantile);
+
+static int64_t _TimeSlime_Payroll_Round(TIMESLIME_PAYROLL_RULES_t *rules, int64_t seconds);
+static void _TimeSlime_Payroll_EndDay(TIMESLIME_PAYROLL_STATE_t *state);
+static void _TimeSlime_Payroll_EndWeek(TIMESLIME_PAYROLL_STATE_t *state);
+static void _TimeSlime_Payroll_Emit(TIMESLIME_PAYROLL_STATE_t *state, int kind, int64_t day, TIMESLIME_PAYROLL_PERIOD_t *out);
+
+static TIMESLIME_STATUS_t _TimeSlime_ParseDatePart(const char **cursor, TIMESLIME_DATE_t *date);
+static int _TimeSlime_ReadNumber(const char **cursor, int minDigits, int maxDigits, int *out);
+static int _TimeSlime_DaysInMonth(int year, int month);
 
 static char* _TimeSlime_Time2Str(TIMESLIME_DATETIME_t time);
 static char* _TimeSlime_Date2Str(TIMESLIME_DATE_t date);
 
+static int64_t _TimeSlime_DaysFromCivil(int year, int month, int day);
+static void _TimeSlime_CivilFromDays(int64_t days, int *year, int *month, int *day);
+static int64_t _TimeSlime_DateToDays(TIMESLIME_DATE_t date);
+static int64_t _TimeSlime_TimeToSeconds(TIMESLIME_DATETIME_t time);
+static TIMESLIME_DATETIME_t _TimeSlime_Now(void);
+static void _TimeSlime_FormatDays(int64_t days, char *out);
+static void _TimeSlime_FormatSeconds(int64_t seconds, char *out);
+
+
+/* Storage backends */
+static TIMESLIME_BACKEND_t sqlite_backend = {
+    "sqlite",
+    _TimeSlime_Sqlite_Open,
+    _TimeSlime_Sqlite_Close,
+    _TimeSlime_Sqlite_AddHours,
+    _TimeSlime_Sqlite_ClockIn,
+    _TimeSlime_Sqlite_ClockOut,
+    _TimeSlime_Sqlite_GetOpenSession,
+    _TimeSlime_Sqlite_GetReport,
+    _TimeSlime_Sqlite_Iterate
+};
+
+static TIMESLIME_BACKEND_t log_backend = {
+    "log",
+    _TimeSlime_Log_Open,
+    _TimeSlime_Log_Close,
+    _TimeSlime_Log_AddHours,
+    _TimeSlime_Log_ClockIn,
+    _TimeSlime_Log_ClockOut,
+    _TimeSlime_Log_GetOpenSession,
+    _TimeSlime_Log_GetReport,
+    _TimeSlime_Log_Iterate
+};
+
+static TIMESLIME_BACKEND_t *backend = &sqlite_backend;
+
 
 /**
- * Initializes the Time Slime library
+ * Selects the storage backend, must be called before TimeSlime_Initialize
  */
-TIMESLIME_STATUS_t TimeSlime_Initialize(char directory_for_database[])
+TIMESLIME_STATUS_t TimeSlime_SetBackend(TIMESLIME_BACKEND_t *storage)
 {
-    database_file_path = NULL;
-    db = NULL;
-    database_results = NULL;
+    if (is_initialized)
+        return TIMESLIME_NOT_SUPPORTED;
 
-    is_initialized = 1;
-
-    // Generate path for database file
-    database_file_path = malloc((strlen(directory_for_database) + 1 + strlen(TIMESLIME_DATABASE_FILE_NAME)) * sizeof(char)); /* + 1 for the slash */
-    if (database_file_path == NULL)
+    if (storage == NULL)
         return TIMESLIME_UNKOWN_ERROR;
 
-    sprintf(database_file_path, "%s%s%s", directory_for_database, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_DATABASE_FILE_NAME); // Append the file name
-    // Create database if it doesn't exist
-    int rc;
-    rc = sqlite3_open(database_file_path, &db);
-    if (rc != SQLITE_OK)
+    backend = storage;
+    return TIMESLIME_OK;
+}
+
+/**
+ * Looks up one of the built in storage backends by name ("sqlite" or "log")
+ */
+TIMESLIME_BACKEND_t* TimeSlime_GetBackend(char *name)
+{
+    if (strcmp(name, sqlite_backend.Name) == 0)
+        return &sqlite_backend;
+    if (strcmp(name, log_backend.Name) == 0)
+        return &log_backend;
+
+    return NULL;
+}
+
+/**
+ * Gets the settings for a named storage tuning profile
+ */
+TIMESLIME_STATUS_t TimeSlime_GetProfile(char *profile, TIMESLIME_SETTINGS_t *out)
+{
+    int i;
+    for (i = 0; i < (int)(sizeof(profiles) / sizeof(profiles[0])); i++)
     {
-        return TIMESLIME_SQLITE_ERROR;
+        if (strcmp(profile, profiles[i].Name) == 0)
+        {
+            *out = profiles[i].Settings;
+            return TIMESLIME_OK;
+        }
     }
 
-    // Initialize the results array
-    database_results = (TIMESLIME_INTERNAL_ROW_t**)malloc(TIMESLIME_DEFAULT_RESULT_LIMIT * sizeof(TIMESLIME_INTERNAL_ROW_t*));
-    if (database_results == NULL)
+    return TIMESLIME_INVALID_PROFILE;
+}
+
+/**
+ * Applies a named storage tuning profile
+ */
+TIMESLIME_STATUS_t TimeSlime_Configure(char *profile)
+{
+    TIMESLIME_SETTINGS_t profileSettings;
+
+    TIMESLIME_STATUS_t status = TimeSlime_GetProfile(profile, &profileSettings);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    return TimeSlime_ConfigureSettings(profileSettings);
+}
+
+/**
+ * Applies storage settings. Before initializing they are kept until the storage is opened,
+ * which is the only time a new database can still take a different page size.
+ */
+TIMESLIME_STATUS_t TimeSlime_ConfigureSettings(TIMESLIME_SETTINGS_t newSettings)
+{
+    settings = newSettings;
+    has_settings = 1;
+
+    if (!is_initialized)
+        return TIMESLIME_OK;
+
+    _TimeSlime_Checkpoint_Stop();
+    TIMESLIME_STATUS_t status = _TimeSlime_ApplySettings();
+    _TimeSlime_Checkpoint_Start();
+
+    return status;
+}
+
+/**
+ * Initializes the Time Slime library
+ */
+TIMESLIME_STATUS_t TimeSlime_Initialize(char directory_for_database[])
+{
+    is_initialized = 1;
+
+    TIMESLIME_STATUS_t status = backend->Open(directory_for_database);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status_file_path = _TimeSlime_StatusFilePath(directory_for_database);
+    if (status_file_path == NULL)
         return TIMESLIME_UNKOWN_ERROR;
 
-    result_array_size = TIMESLIME_DEFAULT_RESULT_LIMIT;
-    int i;
-    for (i = 0; i < result_array_size; i++)
-        database_results[i] = NULL;
+    // First run, or the last write could not update it
+    FILE *statusFile = fopen(status_file_path, "r");
+    if (statusFile == NULL)
+        _TimeSlime_WriteStatusFile();
+    else
+        fclose(statusFile);
+
+    _TimeSlime_Checkpoint_Start();
 
-    return _TimeSlime_CreateTables();
+    return TIMESLIME_OK;
 }
 
 /**
@@ -88,33 +574,159 @@ TIMESLIME_STATUS_t TimeSlime_Close(void)
     if (!is_initialized)
         return TIMESLIME_NOT_INITIALIZED;
 
-    int rc;
-    if (db != NULL)
+    // Queued requests still run, and their callbacks are called here
+    TimeSlime_StopAsync();
+    _TimeSlime_Checkpoint_Stop();
+
+    is_initialized = 0;
+
+    free(status_file_path);
+    status_file_path = NULL;
+
+    return backend->Close();
+}
+
+/**
+ * Reads the open session and today's hours from the status file. Only the one small file
+ * is read, neither the database nor the log is opened, so this is cheap enough for a shell prompt.
+ */
+TIMESLIME_STATUS_t TimeSlime_GetStatus(char directory_for_database[], TIMESLIME_CLOCK_STATUS_t *out)
+{
+    int version;
+    int id;
+    long long clockIn;
+    long long day;
+    double dayHours;
+
+    char *path = _TimeSlime_StatusFilePath(directory_for_database);
+    if (path == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL)
+        return TIMESLIME_NO_STATUS;
+
+    int read = fscanf(file, _TIMESLIME_STATUS_FORMAT, &version, &id, &clockIn, &day, &dayHours);
+    fclose(file);
+    if (read != 5 || version != _TIMESLIME_STATUS_VERSION)
+        return TIMESLIME_NO_STATUS;
+
+    int64_t now = _TimeSlime_TimeToSeconds(TIMESLIME_TIME_NOW);
+    int64_t today = _TIMESLIME_FLOOR_DIV(now, _TIMESLIME_SECONDS_PER_DAY);
+
+    memset(out, 0, sizeof(TIMESLIME_CLOCK_STATUS_t));
+    out->TodayHours = (day == today) ? dayHours : 0;
+    strcpy(out->ClockInTime, "NULL");
+
+    if (id != 0)
     {
-        rc = sqlite3_close(db);
-        if (rc != SQLITE_OK)
-        {
-            printf("SQLITE CLOSING ERROR: %d\n", rc);
-        }
+        // Only the part of the session since midnight counts for today
+        int64_t todayStart = today * _TIMESLIME_SECONDS_PER_DAY;
+
+        out->ClockedIn = 1;
+        out->ID = id;
+        out->SessionHours = (now - clockIn) / 3600.0;
+        out->TodayHours += (now - ((clockIn > todayStart) ? clockIn : todayStart)) / 3600.0;
+        _TimeSlime_FormatSeconds(clockIn, out->ClockInTime);
     }
 
-    if (database_file_path != NULL)
+    return TIMESLIME_OK;
+}
+
+/**
+ * Attaches another time sheet database file, so reports cover its entries as well.
+ * The span of dates in the file is read once here and used to skip the file for
+ * reports outside of it, attached files are expected to be closed out archives.
+ */
+TIMESLIME_STATUS_t TimeSlime_AttachDatabase(char *path)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    if (number_of_attached >= TIMESLIME_MAX_ATTACHED)
+        return TIMESLIME_TOO_MANY_DATABASES;
+
+    // ATTACH would create a missing file
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return TIMESLIME_INVALID_DATABASE;
+    fclose(file);
+
+    TIMESLIME_ATTACHED_t *attach = &attached[number_of_attached];
+    sprintf(attach->Schema, "Attached%d", number_of_attached);
+
+    char *sql = sqlite3_mprintf("ATTACH DATABASE %Q AS %s", path, attach->Schema);
+    if (sql == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_ExecuteQuery(sql, 0);
+    sqlite3_free(sql);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    // Must be a time sheet, and not a file that is already part of reports
+    int i;
+    int isTimeSheet = 0;
+    char query[500];
+    const char *attachedFile = sqlite3_db_filename(db, attach->Schema);
+
+    sprintf(query, "SELECT COUNT(*) FROM %s.sqlite_master WHERE type = 'table' AND name = 'TimeSheet'", attach->Schema);
+    status = _TimeSlime_QueryInt(query, &isTimeSheet);
+    if (status == TIMESLIME_OK && !isTimeSheet)
+        status = TIMESLIME_INVALID_DATABASE;
+    if (status == TIMESLIME_OK && strcmp(attachedFile, sqlite3_db_filename(db, "main")) == 0)
+        status = TIMESLIME_INVALID_DATABASE;
+    for (i = 0; i < number_of_attached && status == TIMESLIME_OK; i++)
     {
-        free(database_file_path);
-        database_file_path = NULL;
+        if (strcmp(attachedFile, sqlite3_db_filename(db, attached[i].Schema)) == 0)
+            status = TIMESLIME_INVALID_DATABASE;
     }
 
-    if (database_results != NULL)
+    // Span of dates, an empty file never overlaps a report
+    sprintf(query, "SELECT COALESCE(CAST(JULIANDAY(MIN(" __TS_QRY_ENTRY_DATE ")) - 2440587.5 AS INTEGER), %d) FROM %s.TimeSheet", INT_MAX, attach->Schema);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt(query, &attach->FirstDay);
+
+    sprintf(query, "SELECT COALESCE(CAST(JULIANDAY(MAX(" __TS_QRY_ENTRY_DATE ")) - 2440587.5 AS INTEGER), %d) FROM %s.TimeSheet", INT_MIN, attach->Schema);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt(query, &attach->LastDay);
+
+    if (status != TIMESLIME_OK)
     {
-        int i;
-        for (i = 0; i < number_of_results; i++)
-        {
-            free(database_results[i]);
-            database_results[i] = NULL;
-        }
+        sprintf(query, "DETACH DATABASE %s", attach->Schema);
+        sqlite3_exec(db, query, NULL, 0, NULL);
+        return status;
+    }
 
-        free(database_results);
-        database_results = NULL;
+    number_of_attached++;
+    return TIMESLIME_OK;
+}
+
+/**
+ * Detaches every attached database file
+ */
+TIMESLIME_STATUS_t TimeSlime_DetachDatabases(void)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char sql[100];
+    while (number_of_attached > 0)
+    {
+        sprintf(sql, "DETACH DATABASE %s", attached[number_of_attached - 1].Schema);
+
+        TIMESLIME_STATUS_t status = _TimeSlime_ExecuteQuery(sql, 0);
+        if (status != TIMESLIME_OK)
+            return status;
+
+        number_of_attached--;
     }
 
     return TIMESLIME_OK;
@@ -124,6 +736,14 @@ TIMESLIME_STATUS_t TimeSlime_Close(void)
  *  Add a set amount of hours to the Time Slime time sheet
  */
 TIMESLIME_STATUS_t TimeSlime_AddHours(float hours, TIMESLIME_DATE_t date)
+{
+    return TimeSlime_AddProjectHours(hours, date, NULL);
+}
+
+/**
+ *  Add a set amount of hours to the Time Slime time sheet, billed to a project
+ */
+TIMESLIME_STATUS_t TimeSlime_AddProjectHours(float hours, TIMESLIME_DATE_t date, char *project)
 {
     if (!is_initialized)
         return TIMESLIME_NOT_INITIALIZED;
@@ -133,49 +753,48 @@ TIMESLIME_STATUS_t TimeSlime_AddHours(float hours, TIMESLIME_DATE_t date)
     if (paramTest != TIMESLIME_OK)
         return paramTest;
 
-    // Create new row to be inserted
-    TIMESLIME_INTERNAL_ROW_t entry;
-    entry.HoursAdded = hours;
-    strcpy(entry.ClockInTime, "NULL");
-    strcpy(entry.ClockOutTime, "NULL");
+    TIMESLIME_STATUS_t status = _TimeSlime_ProjectID(project, &entry_project_id);
+    if (status == TIMESLIME_OK)
+        status = backend->AddHours(hours, date);
+    entry_project_id = 0;
 
-    char *dateStr = _TimeSlime_Date2Str(date);
-    strcpy(entry.HoursAddedDate, dateStr);
-    free(dateStr);
+    if (status == TIMESLIME_OK)
+        _TimeSlime_WriteStatusFile();
 
-    return _TimeSlime_InsertEntry(&entry);
+    return status;
 }
 
 /**
  *  Clock in to the Time Slime time sheet
  */
 TIMESLIME_STATUS_t TimeSlime_ClockIn(TIMESLIME_DATETIME_t time)
+{
+    return TimeSlime_ClockInProject(time, NULL);
+}
+
+/**
+ *  Clock in to the Time Slime time sheet, billed to a project
+ */
+TIMESLIME_STATUS_t TimeSlime_ClockInProject(TIMESLIME_DATETIME_t time, char *project)
 {
     if (!is_initialized)
         return TIMESLIME_NOT_INITIALIZED;
 
-    TIMESLIME_STATUS_t status;
     // Verify parameters are valid
-    status = _TimeSlime_VerifyTimestamp(time);
-    if (status != TIMESLIME_OK)
-        return status;
-
-    // Check if already clocked in
-    _TimeSlime_SelectEntries(0, __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES);
-    if (number_of_results > 0)
-        return TIMESLIME_ALREADY_CLOCKED_IN;
+    TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyTimestamp(time);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
 
-    // Create new row to be inserted
-    TIMESLIME_INTERNAL_ROW_t entry;
-    entry.HoursAdded = 0;
-    strcpy(entry.HoursAddedDate, "NULL");
-    strcpy(entry.ClockOutTime, "NULL");
+    // The backend checks for an open session in the same step as the insert
+    TIMESLIME_STATUS_t status = _TimeSlime_ProjectID(project, &entry_project_id);
+    if (status == TIMESLIME_OK)
+        status = backend->ClockIn(time);
+    entry_project_id = 0;
 
-    char *timeStr = _TimeSlime_Time2Str(time);
-    strcpy(entry.ClockInTime, timeStr);
-    free(timeStr);
+    if (status == TIMESLIME_OK)
+        _TimeSlime_WriteStatusFile();
 
-    return _TimeSlime_InsertEntry(&entry);
+    return status;
 }
 
 /**
@@ -191,46 +810,1988 @@ TIMESLIME_STATUS_t TimeSlime_ClockOut(TIMESLIME_DATETIME_t time)
     if (paramTest != TIMESLIME_OK)
         return paramTest;
 
-    // Check if already clocked in
-    _TimeSlime_SelectEntries(0, __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES);
-    if (number_of_results == 0 )
-        return TIMESLIME_NOT_CLOCKED_IN;
-
-    int id = number_of_results - 1; // Last row item ID
-
-    // Prep for update
-    char *timeStr = _TimeSlime_Time2Str(time);
-    strcpy(database_results[id]->ClockOutTime, timeStr);
-    free(timeStr);
+    TIMESLIME_STATUS_t status = backend->ClockOut(time);
+    if (status == TIMESLIME_OK)
+        _TimeSlime_WriteStatusFile();
 
-    return _TimeSlime_UpdateEntry(database_results[id]);
+    return status;
 }
 
 /**
- *  Gets the time sheet for a period of time
+ *  Starts the timer of a job, which runs alongside the timers of other jobs. Each job is
+ *  a project and can only have one open session, found through the open session index.
+ *  Job sessions are marked so plain clock in and out never see them.
  */
-TIMESLIME_STATUS_t TimeSlime_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out)
+TIMESLIME_STATUS_t TimeSlime_ClockInJob(TIMESLIME_DATETIME_t time, char *job)
 {
+    char sql[500];
+    int open = 0;
+
     if (!is_initialized)
         return TIMESLIME_NOT_INITIALIZED;
 
-    int i;
-    TIMESLIME_STATUS_t paramTest;
-    char sql[1000];
-
-    *out = NULL;
-
-    // Test parameters and make sure they are valid dates
-    paramTest = _TimeSlime_VerifyDate(start);
-    if (paramTest != TIMESLIME_OK)
-        return paramTest;
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
 
-    paramTest = _TimeSlime_VerifyDate(end);
+    // Verify parameters are valid
+    TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyTimestamp(time);
     if (paramTest != TIMESLIME_OK)
         return paramTest;
 
-    char *startDate = _TimeSlime_Date2Str(start);
-    char *endDate = _TimeSlime_Date2Str(end);
+    if (job == NULL)
+        return TIMESLIME_INVALID_PROJECT;
+
+    // Create new row to be inserted
+    TIMESLIME_INTERNAL_ROW_t entry;
+    entry.HoursAdded = 0;
+    entry.Job = 1;
+    strcpy(entry.HoursAddedDate, "NULL");
+    strcpy(entry.ClockOutTime, "NULL");
+
+    char *timeStr = _TimeSlime_Time2Str(time);
+    strcpy(entry.ClockInTime, timeStr);
+    free(timeStr);
+
+    int nested;
+    TIMESLIME_STATUS_t status = _TimeSlime_BeginWrite(&nested);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_ProjectID(job, &entry.ProjectID);
+    if (status == TIMESLIME_OK)
+    {
+        sprintf(sql, "SELECT COUNT(*) FROM TimeSheet WHERE Job = 1 AND ProjectID = %d AND " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES, entry.ProjectID);
+        status = _TimeSlime_QueryInt(sql, &open);
+    }
+    if (status == TIMESLIME_OK && open > 0)
+        status = TIMESLIME_ALREADY_CLOCKED_IN;
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_InsertEntry(&entry);
+
+    status = _TimeSlime_EndWrite(nested, status);
+    if (status == TIMESLIME_OK)
+        _TimeSlime_WriteStatusFile();
+
+    return status;
+}
+
+/**
+ *  Stops the timer of a job, leaving the timers of other jobs running
+ */
+TIMESLIME_STATUS_t TimeSlime_ClockOutJob(TIMESLIME_DATETIME_t time, char *job)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    // Verify parameters are valid
+    TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyTimestamp(time);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    if (job == NULL)
+        return TIMESLIME_INVALID_PROJECT;
+
+    // A job that was never used has no project yet, so nothing matches
+    char *timeStr = _TimeSlime_Time2Str(time);
+    char *sql = sqlite3_mprintf("UPDATE TimeSheet " \
+                                "SET ClockOutTime = %s, LastUpdateTime = DATETIME('now', 'localtime') " \
+                                "WHERE ID = (SELECT MAX(ID) FROM TimeSheet " \
+                                    "WHERE Job = 1 AND ProjectID = (SELECT ID FROM Projects WHERE Name = %Q) AND " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES ")",
+            timeStr,
+            job
+        );
+    free(timeStr);
+    if (sql == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    int affected = 0;
+    TIMESLIME_STATUS_t status = _TimeSlime_ExecuteChange(sql, &affected);
+    sqlite3_free(sql);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    // Nothing to close
+    if (affected == 0)
+        return TIMESLIME_NOT_CLOCKED_IN;
+
+    _TimeSlime_WriteStatusFile();
+    return TIMESLIME_OK;
+}
+
+/**
+ *  Adds hours once per key. The key is claimed and the hours added in one transaction,
+ *  so a retry after a timeout either finds the key and returns the first result without
+ *  adding anything, or finds nothing because the first attempt never committed.
+ */
+TIMESLIME_STATUS_t TimeSlime_AddHoursKeyed(char *key, float hours, TIMESLIME_DATE_t date, char *project)
+{
+    int nested;
+    TIMESLIME_STATUS_t original;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Keyed_Begin(key, &nested, &original);
+    if (status != TIMESLIME_OK || original != _TIMESLIME_KEY_NEW)
+        return (status != TIMESLIME_OK) ? status : original;
+
+    return _TimeSlime_Keyed_End(key, nested, TimeSlime_AddProjectHours(hours, date, project));
+}
+
+/**
+ *  Clocks in once per key, see TimeSlime_AddHoursKeyed
+ */
+TIMESLIME_STATUS_t TimeSlime_ClockInKeyed(char *key, TIMESLIME_DATETIME_t time, char *project)
+{
+    int nested;
+    TIMESLIME_STATUS_t original;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Keyed_Begin(key, &nested, &original);
+    if (status != TIMESLIME_OK || original != _TIMESLIME_KEY_NEW)
+        return (status != TIMESLIME_OK) ? status : original;
+
+    return _TimeSlime_Keyed_End(key, nested, TimeSlime_ClockInProject(time, project));
+}
+
+/**
+ *  Clocks out once per key, see TimeSlime_AddHoursKeyed
+ */
+TIMESLIME_STATUS_t TimeSlime_ClockOutKeyed(char *key, TIMESLIME_DATETIME_t time)
+{
+    int nested;
+    TIMESLIME_STATUS_t original;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Keyed_Begin(key, &nested, &original);
+    if (status != TIMESLIME_OK || original != _TIMESLIME_KEY_NEW)
+        return (status != TIMESLIME_OK) ? status : original;
+
+    return _TimeSlime_Keyed_End(key, nested, TimeSlime_ClockOut(time));
+}
+
+/**
+ *  Gets the time sheet for a period of time
+ */
+TIMESLIME_STATUS_t TimeSlime_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    TIMESLIME_STATUS_t paramTest;
+
+    *out = NULL;
+
+    // Test parameters and make sure they are valid dates
+    paramTest = _TimeSlime_VerifyDate(start);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    paramTest = _TimeSlime_VerifyDate(end);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    return backend->GetReport(start, end, out);
+}
+
+/**
+ *  Gets the total hours worked in a period of time. The running totals answer it with a
+ *  lookup per level whatever the size of the range; attached files and the log backend
+ *  have none, so the total of a report is used for them.
+ */
+TIMESLIME_STATUS_t TimeSlime_GetTotalHours(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, double *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    TIMESLIME_STATUS_t paramTest;
+    char sql[1000];
+    long long seconds = 0;
+
+    *out = 0;
+
+    // Test parameters and make sure they are valid dates
+    paramTest = _TimeSlime_VerifyDate(start);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    paramTest = _TimeSlime_VerifyDate(end);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    if (backend != &sqlite_backend || number_of_attached > 0)
+    {
+        TIMESLIME_REPORT_t *report;
+        TIMESLIME_STATUS_t status = backend->GetReport(start, end, &report);
+        if (status != TIMESLIME_OK)
+            return status;
+
+        *out = report->TotalHours;
+        TimeSlime_FreeReport(&report);
+        return TIMESLIME_OK;
+    }
+
+    // Day numbers of the first day and of the day after the last, 1970-01-01 is day 719163
+    int first = (int)(_TimeSlime_DateToDays(start) + 719163);
+    int after = (int)(_TimeSlime_DateToDays(end) + 719163 + 1);
+    if (after <= first)
+        return TIMESLIME_OK;
+
+    // Total of the days before the day after the range, less the total of the days before it.
+    // CROSS JOIN keeps the levels outside so each block is a primary key lookup
+    sprintf(sql,    "SELECT " \
+                        "(SELECT COALESCE(SUM(Seconds), 0) FROM TimeSheetTotalLevels CROSS JOIN TimeSheetTotals USING (Level) " \
+                            "WHERE (%d >> Level) & 1 AND Block = (%d >> Level) - 1) - " \
+                        "(SELECT COALESCE(SUM(Seconds), 0) FROM TimeSheetTotalLevels CROSS JOIN TimeSheetTotals USING (Level) " \
+                            "WHERE (%d >> Level) & 1 AND Block = (%d >> Level) - 1)",
+            after, after,
+            first, first
+        );
+
+    // Seconds pass what an int holds at about 596523 hours
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt64(sql, &seconds);
+    if (status == TIMESLIME_OK)
+        *out = seconds / 3600.0;
+
+    return status;
+}
+
+/**
+ *  Calls callback for every entry matching the filter, in the order they were added.
+ *  Returning non-zero from the callback stops the iteration.
+ */
+TIMESLIME_STATUS_t TimeSlime_IterateEntries(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (!_TIMESLIME_IS_DATE_ANY(filter.start))
+    {
+        TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyDate(filter.start);
+        if (paramTest != TIMESLIME_OK)
+            return paramTest;
+    }
+
+    if (!_TIMESLIME_IS_DATE_ANY(filter.end))
+    {
+        TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyDate(filter.end);
+        if (paramTest != TIMESLIME_OK)
+            return paramTest;
+    }
+
+    return backend->Iterate(filter, callback, userdata);
+}
+
+/* Frees memory allocated for report used in report method */
+void TimeSlime_FreeReport(TIMESLIME_REPORT_t **report)
+{
+    if (*report != NULL)
+    {
+        free(*report);
+        *report = NULL;
+    }
+}
+
+/**
+ * Gets the time sheet for a period of time as one whole number of minutes per day, in an array
+ * with a slot for every day of the range. Days are summed in double precision and rounded once, and
+ * no date strings are stored, so years of days are a few KB that can be scanned and summed directly.
+ */
+TIMESLIME_STATUS_t TimeSlime_GetDenseReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_DENSE_REPORT_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    *out = NULL;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_VerifyDate(start);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_VerifyDate(end);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    int64_t startDay = _TimeSlime_DateToDays(start);
+    int64_t endDay = _TimeSlime_DateToDays(end);
+    int days = (endDay >= startDay) ? (int)(endDay - startDay + 1) : 0;
+
+    TIMESLIME_DENSE_REPORT_t *report = (TIMESLIME_DENSE_REPORT_t*)calloc(1, sizeof(TIMESLIME_DENSE_REPORT_t) + (days * sizeof(int32_t)));
+    if (report == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    _TimeSlime_CivilFromDays(startDay, &report->Start.year, &report->Start.month, &report->Start.day);
+    report->NumberOfDays = days;
+
+    if (backend == &sqlite_backend && days > 0)
+    {
+        char source[(TIMESLIME_MAX_ATTACHED + 1) * 400];
+        char sql[(TIMESLIME_MAX_ATTACHED + 1) * 400 + 1000];
+        char startDate[TIMESLIME_DATETIME_STR_LENGTH];
+        char endDate[TIMESLIME_DATETIME_STR_LENGTH];
+
+        _TimeSlime_BuildReportSource(start, end, source);
+        _TimeSlime_FormatDays(startDay, startDate);
+        _TimeSlime_FormatDays(endDay, endDate);
+
+        sprintf(sql,    "SELECT CAST(JULIANDAY(TimeSheetDate) - JULIANDAY('%s') AS INTEGER), CAST(ROUND(SUM(Hours) * 60) AS INTEGER) FROM (" \
+                            "SELECT " __TS_QRY_ENTRY_HOURS " AS Hours, " __TS_QRY_ENTRY_DATE " AS TimeSheetDate FROM %s " \
+                            "WHERE (" __TS_QRY_GET_ALL_ENTIRES ") AND " __TS_QRY_ENTRY_DATE " BETWEEN '%s' AND '%s'" \
+                        ") GROUP BY TimeSheetDate",
+                startDate,
+                source,
+                startDate,
+                endDate
+            );
+
+        status = _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_DENSE_CALLBACK, report, &db_error));
+    }
+    else if (days > 0)
+    {
+        // Other backends only have the report by date
+        TIMESLIME_REPORT_t *sparse = NULL;
+        int i;
+
+        status = backend->GetReport(start, end, &sparse);
+        for (i = 0; status == TIMESLIME_OK && i < sparse->NumberOfEntries; i++)
+        {
+            TIMESLIME_DATE_t date;
+            if (TimeSlime_ParseDate(sparse->Entries[i].Date, &date) != TIMESLIME_OK)
+                continue;
+
+            int64_t day = _TimeSlime_DateToDays(date) - startDay;
+            double minutes = sparse->Entries[i].Hours * 60.0;
+            if (day >= 0 && day < days)
+                report->Minutes[day] += (int32_t)(minutes + ((minutes >= 0) ? 0.5 : -0.5));
+        }
+        TimeSlime_FreeReport(&sparse);
+    }
+
+    if (status != TIMESLIME_OK)
+    {
+        free(report);
+        return status;
+    }
+
+    report->TotalMinutes = TimeSlime_SumDenseReport(report, 0, report->NumberOfDays);
+
+    *out = report;
+    return TIMESLIME_OK;
+}
+
+/**
+ * Minutes worked over a run of days of a dense report, clamped to the report
+ */
+int64_t TimeSlime_SumDenseReport(TIMESLIME_DENSE_REPORT_t *report, int first, int count)
+{
+    int64_t total = 0;
+    int i;
+
+    if (first < 0)
+    {
+        count += first;
+        first = 0;
+    }
+    if (count > report->NumberOfDays - first)
+        count = report->NumberOfDays - first;
+
+    for (i = 0; i < count; i++)
+        total += report->Minutes[first + i];
+
+    return total;
+}
+
+/**
+ * Formats the date of a day of a dense report
+ */
+void TimeSlime_DenseReportDate(TIMESLIME_DENSE_REPORT_t *report, int day, char out[TIMESLIME_DATETIME_STR_LENGTH])
+{
+    _TimeSlime_FormatDays(_TimeSlime_DateToDays(report->Start) + day, out);
+}
+
+/**
+ * Converts a dense report to the report by date, with an entry for each day with time on it
+ */
+TIMESLIME_STATUS_t TimeSlime_DenseToReport(TIMESLIME_DENSE_REPORT_t *dense, TIMESLIME_REPORT_t **out)
+{
+    int used = 0;
+    int i;
+
+    for (i = 0; i < dense->NumberOfDays; i++)
+        used += (dense->Minutes[i] != 0);
+
+    TIMESLIME_REPORT_t *report = (TIMESLIME_REPORT_t*)malloc(sizeof(TIMESLIME_REPORT_t) + (used * sizeof(TIMESLIME_REPORT_ENTRY_t)));
+    if (report == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    int64_t startDay = _TimeSlime_DateToDays(dense->Start);
+    report->NumberOfEntries = 0;
+    report->TotalHours = (float)(dense->TotalMinutes / 60.0);
+    for (i = 0; i < dense->NumberOfDays; i++)
+    {
+        if (dense->Minutes[i] == 0)
+            continue;
+
+        TIMESLIME_REPORT_ENTRY_t *entry = &report->Entries[report->NumberOfEntries++];
+        entry->Hours = (float)(dense->Minutes[i] / 60.0);
+        _TimeSlime_FormatDays(startDay + i, entry->Date);
+    }
+
+    *out = report;
+    return TIMESLIME_OK;
+}
+
+/* Frees memory allocated for report used in dense report method */
+void TimeSlime_FreeDenseReport(TIMESLIME_DENSE_REPORT_t **report)
+{
+    if (*report != NULL)
+    {
+        free(*report);
+        *report = NULL;
+    }
+}
+
+/**
+ * Gets the hours of each project over a period of time, entries without a project come first.
+ * Each project is summed on its own over the (ProjectID, date) index, so the cost grows with
+ * the entries in the range and the number of projects, not the size of the time sheet.
+ */
+TIMESLIME_STATUS_t TimeSlime_GetProjectReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_PROJECT_REPORT_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_VerifyDate(start);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_VerifyDate(end);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    // Every project, and the entries without one
+    int size = 0;
+    status = _TimeSlime_QueryInt("SELECT COUNT(*) + 1 FROM Projects", &size);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    TIMESLIME_PROJECT_REPORT_t *report = (TIMESLIME_PROJECT_REPORT_t*)malloc(sizeof(TIMESLIME_PROJECT_REPORT_t) + (size * sizeof(TIMESLIME_PROJECT_REPORT_ENTRY_t)));
+    if (report == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    report->NumberOfProjects = 0;
+    report->TotalHours = 0;
+
+    char sql[2000];
+    char *startDate = _TimeSlime_Date2Str(start);
+    char *endDate = _TimeSlime_Date2Str(end);
+    sprintf(sql,    "SELECT Name, Hours, %d FROM (" \
+                        "SELECT NULL AS Name, (SELECT SUM" __TS_QRY_ENTRY_HOURS " FROM TimeSheet " \
+                            "WHERE ProjectID IS NULL AND " __TS_QRY_ENTRY_DATE " BETWEEN %s AND %s AND (" __TS_QRY_GET_ALL_ENTIRES ")) AS Hours " \
+                        "UNION ALL " \
+                        "SELECT Name, (SELECT SUM" __TS_QRY_ENTRY_HOURS " FROM TimeSheet " \
+                            "WHERE ProjectID = Projects.ID AND " __TS_QRY_ENTRY_DATE " BETWEEN %s AND %s AND (" __TS_QRY_GET_ALL_ENTIRES ")) " \
+                        "FROM Projects" \
+                    ") WHERE Hours IS NOT NULL ORDER BY Name",
+            size,
+            startDate,
+            endDate,
+            startDate,
+            endDate
+        );
+    free(startDate);
+    free(endDate);
+
+    status = _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_PROJECT_CALLBACK, report, &db_error));
+    if (status != TIMESLIME_OK)
+    {
+        free(report);
+        return status;
+    }
+
+    *out = report;
+    return TIMESLIME_OK;
+}
+
+/* Frees memory allocated for report used in project report method */
+void TimeSlime_FreeProjectReport(TIMESLIME_PROJECT_REPORT_t **report)
+{
+    if (*report != NULL)
+    {
+        free(*report);
+        *report = NULL;
+    }
+}
+
+/**
+ * Builds a report that TimeSlime_PollWatch keeps up to date. Each poll only reads the
+ * entries inserted or updated since the last one and moves their hours between days,
+ * the report is never run again unless entries were deleted.
+ */
+TIMESLIME_STATUS_t TimeSlime_WatchReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_CALLBACK_t callback, void *userdata, TIMESLIME_WATCH_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyDate(start);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    paramTest = _TimeSlime_VerifyDate(end);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    *out = NULL;
+
+    TIMESLIME_WATCH_t *watch = (TIMESLIME_WATCH_t*)calloc(1, sizeof(TIMESLIME_WATCH_t));
+    if (watch == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    watch->Start = start;
+    watch->End = end;
+    watch->StartDay = _TimeSlime_DateToDays(start);
+    watch->NumberOfDays = (int)(_TimeSlime_DateToDays(end) - watch->StartDay + 1);
+    if (watch->NumberOfDays < 1)
+        watch->NumberOfDays = 1;
+    watch->Callback = callback;
+    watch->UserData = userdata;
+
+    watch->DayHours = (double*)calloc(watch->NumberOfDays, sizeof(double));
+    watch->DayEntries = (int*)calloc(watch->NumberOfDays, sizeof(int));
+    watch->Report = (TIMESLIME_REPORT_t*)malloc(sizeof(TIMESLIME_REPORT_t) + (watch->NumberOfDays * sizeof(TIMESLIME_REPORT_ENTRY_t)));
+    if (watch->DayHours == NULL || watch->DayEntries == NULL || watch->Report == NULL)
+    {
+        TimeSlime_FreeWatch(&watch);
+        return TIMESLIME_UNKOWN_ERROR;
+    }
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Watch_Version(watch, NULL);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_Watch_Rebuild(watch);
+    if (status != TIMESLIME_OK)
+    {
+        TimeSlime_FreeWatch(&watch);
+        return status;
+    }
+
+    _TimeSlime_Watch_Report(watch);
+
+    *out = watch;
+    return TIMESLIME_OK;
+}
+
+/**
+ * Applies the changes since the last poll to a watched report. PRAGMA data_version tells
+ * if another connection committed, and the total changes count covers this one, so a poll
+ * with nothing new does not read the time sheet.
+ */
+TIMESLIME_STATUS_t TimeSlime_PollWatch(TIMESLIME_WATCH_t *watch, int *changed)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    int count = 0;
+    char sql[1000];
+
+    *changed = 0;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Watch_Version(watch, changed);
+    if (status != TIMESLIME_OK || !*changed)
+        return status;
+
+    // Inserts, then updates (clocking out, adjusting) since the last poll. The update time
+    // is compared inclusively, an entry read twice is only counted once
+    sprintf(sql, "SELECT " __TS_QRY_ENTRY_COLUMNS "FROM TimeSheet WHERE LastUpdateTime >= '%s'", watch->LastUpdate);
+    _TimeSlime_FormatSeconds(_TimeSlime_TimeToSeconds(TIMESLIME_TIME_NOW), watch->LastUpdate);
+
+    status = _TimeSlime_SelectEntries(watch->LastID, NULL);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_Watch_Apply(watch);
+
+    number_of_results = 0;
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_ExecuteQuery(sql, 1);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_Watch_Apply(watch);
+
+    // Deleted entries leave no trace to read, the count of entries in the range shows them
+    char *startDate = _TimeSlime_Date2Str(watch->Start);
+    char *endDate = _TimeSlime_Date2Str(watch->End);
+    sprintf(sql, "SELECT COUNT(*) FROM TimeSheet WHERE " __TS_QRY_ENTRY_DATE " BETWEEN %s AND %s AND (" __TS_QRY_GET_ALL_ENTIRES ")", startDate, endDate);
+    free(startDate);
+    free(endDate);
+
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt(sql, &count);
+    if (status == TIMESLIME_OK && count != watch->NumberOfEntries)
+        status = _TimeSlime_Watch_Rebuild(watch);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    _TimeSlime_Watch_Report(watch);
+    return TIMESLIME_OK;
+}
+
+/**
+ * Frees a watched report
+ */
+void TimeSlime_FreeWatch(TIMESLIME_WATCH_t **watch)
+{
+    if (*watch != NULL)
+    {
+        free((*watch)->DayHours);
+        free((*watch)->DayEntries);
+        free((*watch)->Entries);
+        free((*watch)->Report);
+        free(*watch);
+        *watch = NULL;
+    }
+}
+
+/**
+ * Gets the size of the WAL and what the checkpoint thread has done so far. Running is
+ * not set when the database is not in WAL mode or CheckpointPages is 0.
+ */
+TIMESLIME_STATUS_t TimeSlime_GetCheckpointStats(TIMESLIME_CHECKPOINT_STATS_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    memset(out, 0, sizeof(TIMESLIME_CHECKPOINT_STATS_t));
+
+#ifndef _WIN32
+    pthread_mutex_lock(&checkpoint_lock);
+    *out = checkpoint_stats;
+    out->Running = checkpoint_running;
+    out->WalPages = checkpoint_wal_pages;
+    pthread_mutex_unlock(&checkpoint_lock);
+#endif
+
+    char *walPath = malloc(strlen(database_file_path) + 5);
+    if (walPath == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    sprintf(walPath, "%s-wal", database_file_path);
+    FILE *walFile = fopen(walPath, "rb");
+    if (walFile != NULL)
+    {
+        if (fseek(walFile, 0, SEEK_END) == 0)
+            out->WalBytes = ftell(walFile);
+        fclose(walFile);
+    }
+    free(walPath);
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Starts the worker thread that runs async requests, so an event loop never waits on the
+ * disk. fd is the read end of a pipe that becomes readable whenever requests have finished,
+ * add it to poll/epoll and call TimeSlime_DispatchAsync when it is. While the worker is running
+ * the library must only be used through the async functions, it is not safe to call from two threads.
+ */
+TIMESLIME_STATUS_t TimeSlime_StartAsync(int *fd)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+#ifndef _WIN32
+    if (async_running)
+    {
+        *fd = async_pipe[0];
+        return TIMESLIME_OK;
+    }
+
+    if (pipe(async_pipe) != 0)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    // Neither end ever blocks, a full pipe is already readable
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        fcntl(async_pipe[i], F_SETFL, fcntl(async_pipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(async_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    async_stopping = 0;
+    if (pthread_create(&async_thread, NULL, _TimeSlime_Async_Worker, NULL) != 0)
+    {
+        close(async_pipe[0]);
+        close(async_pipe[1]);
+        async_pipe[0] = async_pipe[1] = -1;
+        return TIMESLIME_UNKOWN_ERROR;
+    }
+
+    async_running = 1;
+    *fd = async_pipe[0];
+    return TIMESLIME_OK;
+#else
+    return TIMESLIME_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Waits for the queued requests to run, calls their callbacks and stops the worker thread
+ */
+TIMESLIME_STATUS_t TimeSlime_StopAsync(void)
+{
+#ifndef _WIN32
+    if (!async_running)
+        return TIMESLIME_ASYNC_NOT_STARTED;
+
+    pthread_mutex_lock(&async_lock);
+    async_stopping = 1;
+    pthread_cond_signal(&async_wake);
+    pthread_mutex_unlock(&async_lock);
+
+    pthread_join(async_thread, NULL);
+    async_running = 0;
+
+    TimeSlime_DispatchAsync();
+
+    close(async_pipe[0]);
+    close(async_pipe[1]);
+    async_pipe[0] = async_pipe[1] = -1;
+
+    return TIMESLIME_OK;
+#else
+    return TIMESLIME_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Calls the callbacks of every finished async request, on the calling thread
+ */
+int TimeSlime_DispatchAsync(void)
+{
+#ifndef _WIN32
+    char drain[64];
+    int dispatched = 0;
+
+    if (async_pipe[0] < 0)
+        return 0;
+
+    // Emptied before taking the list, a request finishing after this makes the pipe readable again
+    while (read(async_pipe[0], drain, sizeof(drain)) > 0)
+        ;
+
+    pthread_mutex_lock(&async_lock);
+    TIMESLIME_ASYNC_REQUEST_t *request = async_finished;
+    async_finished = async_finished_last = NULL;
+    pthread_mutex_unlock(&async_lock);
+
+    while (request != NULL)
+    {
+        TIMESLIME_ASYNC_REQUEST_t *next = request->Next;
+
+        if (request->Callback != NULL)
+            request->Callback(request->Status, request->Result, request->UserData);
+        else
+            free(request->Result);
+
+        free(request);
+        request = next;
+        dispatched++;
+    }
+
+    return dispatched;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Queues adding hours on the worker thread. Today is worked out now, a request queued
+ * just before midnight still adds to the day it was made on.
+ */
+TIMESLIME_STATUS_t TimeSlime_AddHoursAsync(float hours, TIMESLIME_DATE_t date, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata)
+{
+    TIMESLIME_ASYNC_REQUEST_t *request = _TimeSlime_Async_New(_TIMESLIME_ASYNC_ADD_HOURS, callback, userdata);
+    if (request == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    if (_TIMESLIME_IS_DATE_TODAY(date))
+    {
+        TIMESLIME_DATETIME_t now = _TimeSlime_Now();
+        date = (TIMESLIME_DATE_t){ now.year, now.month, now.day };
+    }
+
+    request->Hours = hours;
+    request->Start = date;
+    return _TimeSlime_Async_Submit(request);
+}
+
+/**
+ * Queues clocking in on the worker thread, at the time of the call and not when the worker gets to it
+ */
+TIMESLIME_STATUS_t TimeSlime_ClockInAsync(TIMESLIME_DATETIME_t time, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata)
+{
+    TIMESLIME_ASYNC_REQUEST_t *request = _TimeSlime_Async_New(_TIMESLIME_ASYNC_CLOCK_IN, callback, userdata);
+    if (request == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    request->Time = (_TIMESLIME_IS_TIME_NOW(time)) ? _TimeSlime_Now() : time;
+    return _TimeSlime_Async_Submit(request);
+}
+
+/**
+ * Queues clocking out on the worker thread, at the time of the call and not when the worker gets to it
+ */
+TIMESLIME_STATUS_t TimeSlime_ClockOutAsync(TIMESLIME_DATETIME_t time, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata)
+{
+    TIMESLIME_ASYNC_REQUEST_t *request = _TimeSlime_Async_New(_TIMESLIME_ASYNC_CLOCK_OUT, callback, userdata);
+    if (request == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    request->Time = (_TIMESLIME_IS_TIME_NOW(time)) ? _TimeSlime_Now() : time;
+    return _TimeSlime_Async_Submit(request);
+}
+
+/**
+ * Queues a report on the worker thread, the callback is given the report to free
+ */
+TIMESLIME_STATUS_t TimeSlime_GetReportAsync(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata)
+{
+    TIMESLIME_ASYNC_REQUEST_t *request = _TimeSlime_Async_New(_TIMESLIME_ASYNC_REPORT, callback, userdata);
+    if (request == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    request->Start = start;
+    request->End = end;
+    return _TimeSlime_Async_Submit(request);
+}
+
+/**
+ *  Gets the clock sessions in a date range that overlap at least one other session
+ */
+TIMESLIME_STATUS_t TimeSlime_FindOverlaps(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_ENTRIES_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    TIMESLIME_STATUS_t paramTest;
+    char sql[1000];
+
+    *out = NULL;
+
+    paramTest = _TimeSlime_VerifyDate(start);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    paramTest = _TimeSlime_VerifyDate(end);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    char *startDate = _TimeSlime_Date2Str(start);
+    char *endDate = _TimeSlime_Date2Str(end);
+
+    // Window the sessions in the date range, then probe the index once per session
+    // for any other interval that strictly overlaps it (touching sessions are fine)
+    sprintf(sql,    "SELECT " __TS_QRY_ENTRY_COLUMNS \
+                    "FROM TimeSheet " \
+                    "WHERE ID IN (" \
+                        "SELECT a.ID FROM TimeSheetIntervals a, TimeSheetIntervals b " \
+                        "WHERE a.StartTime < " __TS_QRY_MINUTES("DATE(%s, '+1 day')") " AND a.EndTime > " __TS_QRY_MINUTES("%s") " " \
+                        "AND b.StartTime < a.EndTime AND b.EndTime > a.StartTime AND b.ID <> a.ID" \
+                    ") " \
+                    "ORDER BY ClockInTime ASC, ID ASC",
+            endDate,
+            startDate
+        );
+
+    free(startDate);
+    free(endDate);
+
+    number_of_results = 0;
+    TIMESLIME_STATUS_t result = _TimeSlime_ExecuteQuery(sql, 1);
+    if (result != TIMESLIME_OK)
+        return result;
+
+    return _TimeSlime_BuildEntries(out);
+}
+
+/**
+ *  Gets the clock sessions that were open at a point in time
+ */
+TIMESLIME_STATUS_t TimeSlime_ActiveAt(TIMESLIME_DATETIME_t time, TIMESLIME_ENTRIES_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char sql[1000];
+
+    *out = NULL;
+
+    TIMESLIME_STATUS_t paramTest = _TimeSlime_VerifyTimestamp(time);
+    if (paramTest != TIMESLIME_OK)
+        return paramTest;
+
+    char *timeStr = _TimeSlime_Time2Str(time);
+
+    sprintf(sql,    "SELECT " __TS_QRY_ENTRY_COLUMNS \
+                    "FROM TimeSheet " \
+                    "WHERE ID IN (" \
+                        "SELECT ID FROM TimeSheetIntervals WHERE StartTime <= " __TS_QRY_MINUTES("%s") " AND EndTime > " __TS_QRY_MINUTES("%s") \
+                    ") " \
+                    "ORDER BY ClockInTime ASC, ID ASC",
+            timeStr,
+            timeStr
+        );
+
+    free(timeStr);
+
+    number_of_results = 0;
+    TIMESLIME_STATUS_t result = _TimeSlime_ExecuteQuery(sql, 1);
+    if (result != TIMESLIME_OK)
+        return result;
+
+    return _TimeSlime_BuildEntries(out);
+}
+
+/**
+ *  Gets a page of entries matching a filter, ordered by the date they belong to and then ID.
+ *  Pass the ID of the last entry of a page as after_id to get the next page. Pages are
+ *  read with an index seek past that entry, so a page deep in history costs the same as the first.
+ *  The entry must still exist, TIMESLIME_INVALID_CURSOR is returned once it was deleted.
+ */
+TIMESLIME_STATUS_t TimeSlime_ListEntries(TIMESLIME_FILTER_t filter, int after_id, int limit, TIMESLIME_ENTRIES_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char where[1000];
+    char cursor[500];
+    char sql[2500];
+    TIMESLIME_STATUS_t status;
+
+    *out = NULL;
+
+    status = _TimeSlime_FilterToSql(filter, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    if (limit <= 0)
+        limit = TIMESLIME_DEFAULT_RESULT_LIMIT;
+
+    // Resolve the keyset cursor, (date, ID) of the last entry on the previous page.
+    // Pages are in date order, so a deleted entry leaves no position to continue from,
+    // and neither does one without a date, as NULL dates sort before every other.
+    // The row value comparison is not used for a seek, the date bound on its own is.
+    strcpy(cursor, "1=1");
+    if (after_id > 0)
+    {
+        sprintf(sql, "SELECT " __TS_QRY_ENTRY_COLUMNS "FROM TimeSheet WHERE ID = %d", after_id);
+
+        number_of_results = 0;
+        status = _TimeSlime_ExecuteQuery(sql, 1);
+        if (status != TIMESLIME_OK)
+            return status;
+
+        if (number_of_results == 0 || strcmp(database_results[0]->TimeSheetDate, "NULL") == 0)
+            return TIMESLIME_INVALID_CURSOR;
+
+        sprintf(cursor, __TS_QRY_ENTRY_DATE " >= '%s' AND (" __TS_QRY_ENTRY_DATE ", ID) > ('%s', %d)",
+                database_results[0]->TimeSheetDate, database_results[0]->TimeSheetDate, after_id);
+    }
+
+    sprintf(sql,    "SELECT " __TS_QRY_ENTRY_COLUMNS \
+                    "FROM TimeSheet " \
+                    "WHERE %s AND %s " \
+                    "ORDER BY " __TS_QRY_ENTRY_DATE " ASC, ID ASC " \
+                    "LIMIT %d",
+            where,
+            cursor,
+            limit
+        );
+
+    number_of_results = 0;
+    status = _TimeSlime_ExecuteQuery(sql, 1);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    return _TimeSlime_BuildEntries(out);
+}
+
+/**
+ *  Gets the entries changed since a token, one record per entry with its current values.
+ *  An entry changed many times since the token shows up once, at its latest change, so
+ *  the cost of catching up depends on how many entries changed rather than the size of the
+ *  time sheet. NextToken is the sequence of the last change returned, or token when there
+ *  were none; keep it and pass it back to continue.
+ */
+TIMESLIME_STATUS_t TimeSlime_ChangesSince(long long token, int limit, TIMESLIME_CHANGES_t **out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char sql[1500];
+    TIMESLIME_STATUS_t status;
+    TIMESLIME_CHANGES_t *changes;
+
+    *out = NULL;
+
+    if (token < 0)
+        token = 0;
+
+    if (limit <= 0)
+        limit = TIMESLIME_DEFAULT_RESULT_LIMIT;
+
+    changes = (TIMESLIME_CHANGES_t*)malloc(sizeof(TIMESLIME_CHANGES_t) + (limit * sizeof(TIMESLIME_CHANGE_t)));
+    if (changes == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    changes->NumberOfChanges = 0;
+    changes->NextToken = token;
+
+    sprintf(sql,    "SELECT Sequence, EntryID, Deleted, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, " \
+                        __TS_QRY_ENTRY_HOURS ", " __TS_QRY_ENTRY_DATE ", Projects.Name, %d " \
+                    "FROM TimeSheetChanges " \
+                    "LEFT JOIN TimeSheet ON TimeSheet.ID = TimeSheetChanges.EntryID " \
+                    "LEFT JOIN Projects ON Projects.ID = TimeSheet.ProjectID " \
+                    "WHERE Sequence > %lld " \
+                    "ORDER BY Sequence ASC " \
+                    "LIMIT %d",
+            limit,
+            token,
+            limit
+        );
+
+    status = _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_CHANGE_CALLBACK, changes, &db_error));
+    if (status != TIMESLIME_OK)
+    {
+        free(changes);
+        return status;
+    }
+
+    *out = changes;
+    return TIMESLIME_OK;
+}
+
+/* Frees memory allocated for changes returned by TimeSlime_ChangesSince */
+void TimeSlime_FreeChanges(TIMESLIME_CHANGES_t **changes)
+{
+    if (*changes != NULL)
+    {
+        free(*changes);
+        *changes = NULL;
+    }
+}
+
+/**
+ *  Writes the changes made here since the last export to a changeset file for another
+ *  machine. It is read from the change feed, one record per changed entry, so its size
+ *  follows the number of changes rather than the size of the time sheet. Changes that
+ *  came in through TimeSlime_SyncImport are left out. The sync point only moves once the
+ *  file is written; with full set every entry is written, for a machine syncing the first time.
+ */
+TIMESLIME_STATUS_t TimeSlime_SyncExport(char *file_path, int full, TIMESLIME_SYNC_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char sql[1500];
+    int machine = 0;
+    int since = 0;
+    int last = 0;
+
+    memset(out, 0, sizeof(TIMESLIME_SYNC_t));
+
+    TIMESLIME_STATUS_t status = _TimeSlime_GetState("SyncMachine", &machine);
+    if (status == TIMESLIME_OK && !full)
+        status = _TimeSlime_GetState("SyncExported", &since);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt("SELECT COALESCE(MAX(Sequence), 0) FROM TimeSheetChanges", &last);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    FILE *file = fopen(file_path, "wb");
+    if (file == NULL)
+        return TIMESLIME_STORAGE_ERROR;
+
+    fwrite(_TIMESLIME_SYNC_MAGIC, 1, 4, file);
+    fputc(_TIMESLIME_SYNC_VERSION, file);
+    _TimeSlime_Sync_PutVarint(file, (uint64_t)machine);
+
+    // Entries that are gone only have their origin left in the feed
+    sprintf(sql,    "SELECT Deleted, COALESCE(TimeSheet.Origin, TimeSheetChanges.Origin), " \
+                        "COALESCE(TimeSheet.OriginID, TimeSheetChanges.OriginID, EntryID), " \
+                        "QUOTE(HoursAdded), " \
+                        "CAST(JULIANDAY(HoursAddedDate) - 2440587.5 AS INTEGER), " \
+                        "CAST(STRFTIME('%%s', ClockInTime) AS INTEGER), " \
+                        "CAST(STRFTIME('%%s', ClockOutTime) AS INTEGER), " \
+                        "CAST(STRFTIME('%%s', LastUpdateTime, 'utc') AS INTEGER), " \
+                        "Projects.Name, Job " \
+                    "FROM TimeSheetChanges " \
+                    "LEFT JOIN TimeSheet ON TimeSheet.ID = TimeSheetChanges.EntryID " \
+                    "LEFT JOIN Projects ON Projects.ID = TimeSheet.ProjectID " \
+                    "WHERE Sequence > %d AND Sequence <= %d AND (Imported = 0 OR %d) " \
+                    "ORDER BY Sequence ASC",
+            since,
+            last,
+            full
+        );
+
+    TIMESLIME_SYNC_WRITER_t writer = { file, machine, out };
+    status = _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_SYNC_CALLBACK, &writer, &db_error));
+    if (ferror(file))
+        status = TIMESLIME_STORAGE_ERROR;
+
+    fputc(_TIMESLIME_SYNC_END, file);
+    _TimeSlime_Sync_PutVarint(file, (uint64_t)out->Changes);
+    out->Bytes = ftell(file);
+
+    if ((fclose(file) != 0 || out->Bytes < 0) && status == TIMESLIME_OK)
+        status = TIMESLIME_STORAGE_ERROR;
+
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_SetState("SyncExported", last);
+    if (status != TIMESLIME_OK)
+        remove(file_path);
+
+    return status;
+}
+
+/**
+ *  Applies a changeset written by TimeSlime_SyncExport on another machine. Every change is
+ *  applied in one transaction, so a broken or cut short file changes nothing. When an entry
+ *  was changed on both machines the change made last is kept, and deletes always win.
+ *  Importing the same changeset again changes nothing.
+ */
+TIMESLIME_STATUS_t TimeSlime_SyncImport(char *file_path, TIMESLIME_SYNC_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char magic[4];
+    char sql[200];
+    uint64_t sender = 0;
+    uint64_t count = 0;
+    int machine = 0;
+    int before = 0;
+    int flags;
+
+    memset(out, 0, sizeof(TIMESLIME_SYNC_t));
+
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL)
+        return TIMESLIME_INVALID_CHANGESET;
+
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, _TIMESLIME_SYNC_MAGIC, 4) != 0 ||
+        fgetc(file) != _TIMESLIME_SYNC_VERSION || !_TimeSlime_Sync_GetVarint(file, &sender) ||
+        sender == 0 || sender > INT32_MAX)
+    {
+        fclose(file);
+        return TIMESLIME_INVALID_CHANGESET;
+    }
+
+    int nested;
+    TIMESLIME_STATUS_t status = _TimeSlime_BeginWrite(&nested);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_GetState("SyncMachine", &machine);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt("SELECT COALESCE(MAX(Sequence), 0) FROM TimeSheetChanges", &before);
+
+    while (status == TIMESLIME_OK)
+    {
+        TIMESLIME_SYNC_RECORD_t record;
+
+        flags = fgetc(file);
+        if (flags == EOF)
+            status = TIMESLIME_INVALID_CHANGESET;
+        else if (flags == _TIMESLIME_SYNC_END)
+        {
+            if (!_TimeSlime_Sync_GetVarint(file, &count) || count != (uint64_t)out->Changes)
+                status = TIMESLIME_INVALID_CHANGESET;
+            break;
+        }
+        else {
+            status = _TimeSlime_Sync_Read(file, flags, (int)sender, &record);
+            if (status == TIMESLIME_OK)
+                status = _TimeSlime_Sync_Apply(&record, machine, out);
+            out->Changes++;
+        }
+    }
+
+    // What came from the other machine is not sent back to it
+    if (status == TIMESLIME_OK)
+    {
+        sprintf(sql, "UPDATE TimeSheetChanges SET Imported = 1 WHERE Sequence > %d", before);
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+    }
+
+    status = _TimeSlime_EndWrite(nested, status);
+
+    out->Bytes = ftell(file);
+    fclose(file);
+
+    if (status == TIMESLIME_OK && out->Applied > 0)
+        _TimeSlime_WriteStatusFile();
+
+    return status;
+}
+
+/**
+ *  Deletes every entry matching the filter with a single statement
+ */
+TIMESLIME_STATUS_t TimeSlime_DeleteEntries(TIMESLIME_FILTER_t filter, int *affected)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char where[1000];
+    char sql[1500];
+
+    *affected = 0;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_FilterToSql(filter, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    sprintf(sql, "DELETE FROM TimeSheet WHERE %s", where);
+
+    status = _TimeSlime_ExecuteChange(sql, affected);
+    if (status == TIMESLIME_OK)
+        _TimeSlime_WriteStatusFile();
+
+    return status;
+}
+
+/**
+ *  Moves every entry matching the filter by delta_minutes with a single statement.
+ *  Clock times move by the exact amount, added hours move by the whole days in it.
+ */
+TIMESLIME_STATUS_t TimeSlime_AdjustEntries(TIMESLIME_FILTER_t filter, int delta_minutes, int *affected)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char where[1000];
+    char sql[2000];
+
+    *affected = 0;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_FilterToSql(filter, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    sprintf(sql,    "UPDATE TimeSheet SET " \
+                    "ClockInTime = DATETIME(ClockInTime, '%+d minutes'), " \
+                    "ClockOutTime = DATETIME(ClockOutTime, '%+d minutes'), " \
+                    "HoursAddedDate = DATE(HoursAddedDate, '%+d days'), " \
+                    "LastUpdateTime = DATETIME('now', 'localtime') " \
+                    "WHERE %s",
+            delta_minutes,
+            delta_minutes,
+            delta_minutes / (24 * 60),
+            where
+        );
+
+    status = _TimeSlime_ExecuteChange(sql, affected);
+    if (status == TIMESLIME_OK)
+        _TimeSlime_WriteStatusFile();
+
+    return status;
+}
+
+/**
+ * Analyzes work patterns in one streaming pass over the entries in date and clock in order.
+ * Everything is gathered in fixed size accumulators, so memory use does not grow with the range.
+ */
+TIMESLIME_STATUS_t TimeSlime_Analyze(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_ANALYSIS_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char where[1000];
+    char sql[2000];
+    TIMESLIME_ANALYZER_t analyzer;
+    TIMESLIME_FILTER_t filter = { start, end, TIMESLIME_ENTRY_KIND_ALL, TIMESLIME_ENTRY_STATE_CLOSED };
+
+    TIMESLIME_STATUS_t status = _TimeSlime_FilterToSql(filter, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    memset(out, 0, sizeof(TIMESLIME_ANALYSIS_t));
+    memset(&analyzer, 0, sizeof(TIMESLIME_ANALYZER_t));
+    analyzer.Out = out;
+    analyzer.Day = INT64_MIN;
+    analyzer.LastClockOut = INT64_MIN;
+
+    // Ordered by the entry date index, only sessions of the same day need sorting by clock in
+    sprintf(sql,    "SELECT " __TS_QRY_ENTRY_COLUMNS ", " \
+                        "CAST(JULIANDAY(" __TS_QRY_ENTRY_DATE ") - 2440587.5 AS INTEGER), " \
+                        __TS_QRY_SECONDS("ClockInTime") ", " \
+                        __TS_QRY_SECONDS("ClockOutTime") " " \
+                    "FROM TimeSheet " \
+                    "WHERE %s AND (" __TS_QRY_GET_ALL_ENTIRES ") " \
+                    "ORDER BY " __TS_QRY_ENTRY_DATE ", ClockInTime",
+            where
+        );
+
+    status = _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_ANALYZE_CALLBACK, &analyzer, &db_error));
+    if (status != TIMESLIME_OK)
+        return status;
+
+    _TimeSlime_Analyze_EndDay(&analyzer);
+    if (out->NumberOfDays == 0)
+        return TIMESLIME_OK;
+
+    // Averages up to the end of the range, or the last day worked for an open range
+    int64_t lastDay = (_TIMESLIME_IS_DATE_ANY(end)) ? analyzer.Day : _TimeSlime_DateToDays(end);
+    out->Average7Days = _TimeSlime_Analyze_Average(&analyzer, lastDay, 7);
+    out->Average30Days = _TimeSlime_Analyze_Average(&analyzer, lastDay, 30);
+
+    out->MedianSessionHours = _TimeSlime_Analyze_Quantile(&analyzer, 0.5);
+    out->P90SessionHours = _TimeSlime_Analyze_Quantile(&analyzer, 0.9);
+    if (out->NumberOfGaps > 0)
+        out->AverageGapHours = analyzer.GapHours / out->NumberOfGaps;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Works out regular and overtime hours under payroll rules. Entries are read once, in date and clock
+ * in order, and summed in whole minutes: punches are rounded, the unpaid break is taken off long days,
+ * time past the daily limit is overtime, and then regular time past the weekly limit is overtime too.
+ * The callback gets each day worked and each week as soon as they are complete, so memory use does
+ * not grow with the range. Open sessions are not paid until they are closed.
+ */
+TIMESLIME_STATUS_t TimeSlime_Payroll(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_PAYROLL_RULES_t rules, TIMESLIME_PAYROLL_CALLBACK_t callback, void *userdata, TIMESLIME_PAYROLL_PERIOD_t *total)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char where[1000];
+    char sql[2000];
+    TIMESLIME_PAYROLL_STATE_t state;
+    TIMESLIME_FILTER_t filter = { start, end, TIMESLIME_ENTRY_KIND_ALL, TIMESLIME_ENTRY_STATE_CLOSED };
+
+    TIMESLIME_STATUS_t status = _TimeSlime_FilterToSql(filter, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    memset(&state, 0, sizeof(TIMESLIME_PAYROLL_STATE_t));
+    state.Rules = rules;
+    state.Rules.WeekStart = ((rules.WeekStart % 7) + 7) % 7;
+    state.Callback = callback;
+    state.UserData = userdata;
+    state.Day = INT64_MIN;
+    state.Week = INT64_MIN;
+
+    sprintf(sql,    "SELECT HoursAdded, " \
+                        "CAST(JULIANDAY(" __TS_QRY_ENTRY_DATE ") - 2440587.5 AS INTEGER), " \
+                        __TS_QRY_SECONDS("ClockInTime") ", " \
+                        __TS_QRY_SECONDS("ClockOutTime") " " \
+                    "FROM TimeSheet " \
+                    "WHERE %s AND (" __TS_QRY_GET_ALL_ENTIRES ") " \
+                    "ORDER BY " __TS_QRY_ENTRY_DATE ", ClockInTime",
+            where
+        );
+
+    status = _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_PAYROLL_CALLBACK, &state, &db_error));
+    if (status != TIMESLIME_OK)
+        return status;
+
+    _TimeSlime_Payroll_EndDay(&state);
+    _TimeSlime_Payroll_EndWeek(&state);
+
+    if (total != NULL)
+        _TimeSlime_Payroll_Emit(&state, TIMESLIME_PAYROLL_TOTAL, (_TIMESLIME_IS_DATE_ANY(start)) ? state.Day : _TimeSlime_DateToDays(start), total);
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Replaces clock sessions older than the retention period with one added hours entry per day and project,
+ * so reports stay the same. Works through TIMESLIME_COMPACT_CHUNK_DAYS at a time, each in its own
+ * short transaction followed by an incremental vacuum, so other processes are only held up briefly.
+ * A database created before incremental vacuum was turned on keeps its freed pages for reuse, it only
+ * shrinks after TimeSlime_EnableIncrementalVacuum, which is never run from here.
+ */
+TIMESLIME_STATUS_t TimeSlime_Compact(int months, TIMESLIME_COMPACTION_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    char sql[1000];
+    char cutoffDate[TIMESLIME_DATETIME_STR_LENGTH];
+    int cutoff = 0;
+    int first = 0;
+    int autoVacuum = 0;
+
+    memset(out, 0, sizeof(TIMESLIME_COMPACTION_t));
+    if (months <= 0)
+        months = TIMESLIME_RETENTION_MONTHS;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_DatabaseSize(&out->BytesBefore);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt("PRAGMA auto_vacuum", &autoVacuum);
+
+    sprintf(sql, "SELECT CAST(JULIANDAY(DATE('now', 'localtime', '-%d months')) - 2440587.5 AS INTEGER)", months);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt(sql, &cutoff);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    _TimeSlime_FormatDays(cutoff, cutoffDate);
+
+    // Oldest day still holding sessions, it moves forward as each chunk is compacted
+    sprintf(sql,    "SELECT COALESCE(CAST(JULIANDAY(MIN(" __TS_QRY_ENTRY_DATE ")) - 2440587.5 AS INTEGER), %d) " \
+                    "FROM TimeSheet WHERE " __TS_QRY_GET_COMPLTED_CLOCK_ENTRIES " AND " __TS_QRY_ENTRY_DATE " < '%s'",
+            cutoff,
+            cutoffDate
+        );
+
+    while (status == TIMESLIME_OK)
+    {
+        status = _TimeSlime_QueryInt(sql, &first);
+        if (status != TIMESLIME_OK || first >= cutoff)
+            break;
+
+        status = _TimeSlime_CompactChunk(first, (first + TIMESLIME_COMPACT_CHUNK_DAYS < cutoff) ? first + TIMESLIME_COMPACT_CHUNK_DAYS : cutoff, out);
+
+        // 2 = INCREMENTAL
+        if (status == TIMESLIME_OK && autoVacuum == 2)
+            status = _TimeSlime_ExecuteQuery("PRAGMA incremental_vacuum", 0);
+    }
+
+    out->NeedsConversion = (autoVacuum != 2);
+
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_DatabaseSize(&out->BytesAfter);
+
+    return status;
+}
+
+/**
+ * Turns on incremental vacuum for a database created before it was the default, so compacting can hand
+ * freed pages back. This rewrites the whole file in one VACUUM that locks out every other process until
+ * it is done, which is why it is a step of its own and not part of TimeSlime_Compact.
+ */
+TIMESLIME_STATUS_t TimeSlime_EnableIncrementalVacuum(TIMESLIME_COMPACTION_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    int autoVacuum = 0;
+
+    memset(out, 0, sizeof(TIMESLIME_COMPACTION_t));
+
+    TIMESLIME_STATUS_t status = _TimeSlime_DatabaseSize(&out->BytesBefore);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt("PRAGMA auto_vacuum", &autoVacuum);
+
+    // 2 = INCREMENTAL, already converted
+    if (status == TIMESLIME_OK && autoVacuum != 2)
+        status = _TimeSlime_ExecuteQuery("PRAGMA auto_vacuum = INCREMENTAL; VACUUM", 0);
+
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_DatabaseSize(&out->BytesAfter);
+
+    return status;
+}
+
+/**
+ * Checks the entries after the one the last run stopped at, in ID order, a chunk of
+ * TIMESLIME_VERIFY_CHUNK at a time so no read is held open for long. Where it stopped is kept
+ * in the database after every chunk, so a huge time sheet can be verified a piece at a time.
+ * With repair set, each chunk's problems are fixed in one transaction: duplicates are deleted,
+ * older open sessions are closed at zero length, negative sessions have their times swapped and
+ * the clock times of mixed entries are moved to a new entry. Sessions longer than a day are only reported.
+ */
+TIMESLIME_STATUS_t TimeSlime_Verify(int max_entries, int repair, TIMESLIME_PROBLEM_CALLBACK_t callback, void *userdata, TIMESLIME_VERIFY_t *out)
+{
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    TIMESLIME_VERIFY_CHUNK_t chunk;
+    int cursor = 0;
+    int i;
+
+    memset(out, 0, sizeof(TIMESLIME_VERIFY_t));
+
+    TIMESLIME_STATUS_t status = _TimeSlime_GetState("VerifyCursor", &cursor);
+
+    while (status == TIMESLIME_OK && !out->Finished && (max_entries <= 0 || out->EntriesChecked < max_entries))
+    {
+        int limit = TIMESLIME_VERIFY_CHUNK;
+        if (max_entries > 0 && max_entries - out->EntriesChecked < limit)
+            limit = max_entries - out->EntriesChecked;
+
+        // The chunk is read under the write lock, so what is repaired is what was classified.
+        // The cursor is saved with the repairs, so a chunk is never repaired twice
+        int nested;
+        status = _TimeSlime_BeginWrite(&nested);
+        if (status == TIMESLIME_OK)
+            status = _TimeSlime_VerifyChunk(cursor, limit, &chunk);
+        for (i = 0; status == TIMESLIME_OK && i < chunk.NumberOfEntries; i++)
+        {
+            if (repair && (chunk.Problems[i] & _TIMESLIME_REPAIRABLE_PROBLEMS))
+                status = _TimeSlime_RepairEntry(chunk.IDs[i], chunk.Problems[i]);
+        }
+
+        int last = (status == TIMESLIME_OK && chunk.NumberOfEntries > 0) ? chunk.IDs[chunk.NumberOfEntries - 1] : cursor;
+        int finished = (status == TIMESLIME_OK && chunk.NumberOfEntries < limit);
+        if (status == TIMESLIME_OK)
+            status = _TimeSlime_SetState("VerifyCursor", finished ? 0 : last);
+
+        status = _TimeSlime_EndWrite(nested, status);
+        if (status != TIMESLIME_OK)
+            break;
+
+        // Only reported once the repairs are committed
+        if (chunk.NumberOfEntries > 0)
+        {
+            if (out->EntriesChecked == 0)
+                out->FirstID = chunk.IDs[0];
+            out->LastID = last;
+            cursor = last;
+        }
+        out->EntriesChecked += chunk.NumberOfEntries;
+        out->Finished = finished;
+
+        for (i = 0; i < chunk.NumberOfEntries; i++)
+        {
+            if (chunk.Problems[i] == 0)
+                continue;
+
+            int repaired = (repair && (chunk.Problems[i] & _TIMESLIME_REPAIRABLE_PROBLEMS));
+            out->Problems++;
+            out->Repaired += repaired;
+            if (callback != NULL)
+                callback(chunk.IDs[i], chunk.Problems[i], repaired, userdata);
+        }
+    }
+
+    if (out->Repaired > 0)
+        _TimeSlime_WriteStatusFile();
+
+    return status;
+}
+
+/* Frees memory allocated for entries returned by the entry methods */
+void TimeSlime_FreeEntries(TIMESLIME_ENTRIES_t **entries)
+{
+    if (*entries != NULL)
+    {
+        free(*entries);
+        *entries = NULL;
+    }
+}
+
+/**
+ *  Parses a YYYY-MM-DD date (- or / separated) without allocating, and checks it against the calendar
+ */
+TIMESLIME_STATUS_t TimeSlime_ParseDate(const char *str, TIMESLIME_DATE_t *out)
+{
+    TIMESLIME_DATE_t date;
+    const char *cursor = str;
+
+    if (str == NULL)
+        return TIMESLIME_INVALID_FORMAT;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_ParseDatePart(&cursor, &date);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    if (*cursor != '\0')
+        return TIMESLIME_INVALID_FORMAT;
+
+    status = _TimeSlime_VerifyDate(date);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    *out = date;
+    return TIMESLIME_OK;
+}
+
+/**
+ *  Parses a YYYY-MM-DD[ HH:MM[:SS]] date and time in a single pass without allocating.
+ *  The time may be separated from the date by ' ' or 'T', missing time parts are zero.
+ */
+TIMESLIME_STATUS_t TimeSlime_ParseDateTime(const char *str, TIMESLIME_DATETIME_t *out)
+{
+    TIMESLIME_DATE_t date;
+    TIMESLIME_DATETIME_t time = { 0, 0, 0, 0, 0, 0 };
+    const char *cursor = str;
+
+    if (str == NULL)
+        return TIMESLIME_INVALID_FORMAT;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_ParseDatePart(&cursor, &date);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    time.year = date.year;
+    time.month = date.month;
+    time.day = date.day;
+
+    if (*cursor == ' ' || *cursor == 'T')
+    {
+        cursor++;
+        if (!_TimeSlime_ReadNumber(&cursor, 1, 2, &time.hour))
+            return TIMESLIME_INVALID_HOUR;
+
+        if (*cursor++ != ':')
+            return TIMESLIME_INVALID_FORMAT;
+
+        if (!_TimeSlime_ReadNumber(&cursor, 2, 2, &time.minute))
+            return TIMESLIME_INVALID_MINUTE;
+
+        if (*cursor == ':')
+        {
+            cursor++;
+            if (!_TimeSlime_ReadNumber(&cursor, 2, 2, &time.second))
+                return TIMESLIME_INVALID_SECOND;
+        }
+    }
+
+    if (*cursor != '\0')
+        return TIMESLIME_INVALID_FORMAT;
+
+    status = _TimeSlime_VerifyTimestamp(time);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    *out = time;
+    return TIMESLIME_OK;
+}
+
+/**
+ * Converts status to friendly status code (or returns SQLITE error string)
+ */
+char*  TimeSlime_StatusCode(TIMESLIME_STATUS_t status)
+{
+    switch (status)
+    {
+        case TIMESLIME_OK:
+            return "K";
+        case TIMESLIME_UNKOWN_ERROR:
+            return "UKNOWN";
+        case TIMESLIME_INVALID_YEAR:
+            return "INVALID_YEAR";
+        case TIMESLIME_INVALID_MONTH:
+            return "INVALID_MONTH";
+        case TIMESLIME_INVALID_DAY:
+            return "INVALID_DAY";
+        case TIMESLIME_INVALID_HOUR:
+            return "INVALID_HOUR";
+        case TIMESLIME_INVALID_MINUTE:
+            return "INVALID_MINUTE";
+        case TIMESLIME_INVALID_SECOND:
+            return "INVALID_SECOND";
+        case TIMESLIME_INVALID_FORMAT:
+            return "INVALID_FORMAT";
+        case TIMESLIME_INVALID_PROFILE:
+            return "INVALID_PROFILE";
+        case TIMESLIME_INVALID_PROJECT:
+            return "INVALID_PROJECT";
+        case TIMESLIME_INVALID_KEY:
+            return "INVALID_KEY";
+        case TIMESLIME_ALREADY_CLOCKED_IN:
+            return "ALREADY_CLOCKED_IN";
+        case TIMESLIME_NOT_CLOCKED_IN:
+            return "NOT_CLOCKED_IN";
+        case TIMESLIME_NO_ENTIRES:
+            return "NO_TIMESHEET_ENTRIES";
+        case TIMESLIME_NOT_INITIALIZED:
+            return "NOT_INITIALIZED";
+        case TIMESLIME_NOT_SUPPORTED:
+            return "NOT_SUPPORTED";
+        case TIMESLIME_STORAGE_ERROR:
+            return "STORAGE_ERROR";
+        case TIMESLIME_BUSY:
+            return "BUSY";
+        case TIMESLIME_INVALID_DATABASE:
+            return "INVALID_DATABASE";
+        case TIMESLIME_TOO_MANY_DATABASES:
+            return "TOO_MANY_DATABASES";
+        case TIMESLIME_NO_STATUS:
+            return "NO_STATUS";
+        case TIMESLIME_ASYNC_NOT_STARTED:
+            return "ASYNC_NOT_STARTED";
+        case TIMESLIME_INVALID_CHANGESET:
+            return "INVALID_CHANGESET";
+        case TIMESLIME_INVALID_CURSOR:
+            return "INVALID_CURSOR";
+        case TIMESLIME_LOG_CORRUPT:
+            return "LOG_CORRUPT";
+        case TIMESLIME_SQLITE_ERROR:
+            return db_error;
+
+        default:
+            return "?";
+    }
+
+}
+
+
+
+
+
+
+
+/**
+ * Opens (or creates) the SQLITE database, the default storage backend
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_Open(char directory_for_database[])
+{
+    database_file_path = NULL;
+    db = NULL;
+    database_results = NULL;
+
+    // Generate path for database file
+    database_file_path = malloc((strlen(directory_for_database) + 2 + strlen(TIMESLIME_DATABASE_FILE_NAME)) * sizeof(char)); /* + 2 for the slash and terminator */
+    if (database_file_path == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    sprintf(database_file_path, "%s%s%s", directory_for_database, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_DATABASE_FILE_NAME); // Append the file name
+    // Create database if it doesn't exist
+    int rc;
+    rc = sqlite3_open(database_file_path, &db);
+    if (rc != SQLITE_OK)
+    {
+        return TIMESLIME_SQLITE_ERROR;
+    }
+
+    // Other processes may have the file open, wait for their locks instead of failing
+    sqlite3_busy_handler(db, _TimeSlime_BusyHandler, NULL);
+
+    // Lets compaction hand free pages back a few at a time, only has an effect on a new database
+    sqlite3_exec(db, "PRAGMA auto_vacuum = INCREMENTAL", NULL, 0, NULL);
+
+    // Initialize the results array
+    database_results = (TIMESLIME_INTERNAL_ROW_t**)malloc(TIMESLIME_DEFAULT_RESULT_LIMIT * sizeof(TIMESLIME_INTERNAL_ROW_t*));
+    if (database_results == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    result_array_size = TIMESLIME_DEFAULT_RESULT_LIMIT;
+    int i;
+    for (i = 0; i < result_array_size; i++)
+        database_results[i] = NULL;
+
+    // WAL lets readers carry on while another process writes
+    TIMESLIME_STATUS_t status = (has_settings) ? _TimeSlime_ApplySettings() : _TimeSlime_ExecuteQuery("PRAGMA journal_mode = WAL", 0);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_CreateTables();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    return _TimeSlime_MigrateTables();
+}
+
+/**
+ * Closes the SQLITE database
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_Close(void)
+{
+    int rc;
+
+    // Closing the connection detaches every attached file
+    number_of_attached = 0;
+    if (db != NULL)
+    {
+        rc = sqlite3_close(db);
+        if (rc != SQLITE_OK)
+        {
+            printf("SQLITE CLOSING ERROR: %d\n", rc);
+        }
+        db = NULL;
+    }
+
+    if (database_file_path != NULL)
+    {
+        free(database_file_path);
+        database_file_path = NULL;
+    }
+
+    if (database_results != NULL)
+    {
+        int i;
+        for (i = 0; i < result_array_size; i++)
+        {
+            free(database_results[i]);
+            database_results[i] = NULL;
+        }
+
+        free(database_results);
+        database_results = NULL;
+    }
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Inserts an added hours entry
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_AddHours(float hours, TIMESLIME_DATE_t date)
+{
+    // Create new row to be inserted
+    TIMESLIME_INTERNAL_ROW_t entry;
+    entry.HoursAdded = hours;
+    entry.ProjectID = entry_project_id;
+    entry.Job = 0;
+    strcpy(entry.ClockInTime, "NULL");
+    strcpy(entry.ClockOutTime, "NULL");
+
+    char *dateStr = _TimeSlime_Date2Str(date);
+    strcpy(entry.HoursAddedDate, dateStr);
+    free(dateStr);
+
+    return _TimeSlime_InsertEntry(&entry);
+}
+
+/**
+ * Inserts a new open clock session, unless one is already open. The write lock is
+ * taken before the check so no other process can clock in between the two. Running
+ * job timers are not the open session.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_ClockIn(TIMESLIME_DATETIME_t time)
+{
+    int open = 0;
+
+    // Create new row to be inserted
+    TIMESLIME_INTERNAL_ROW_t entry;
+    entry.HoursAdded = 0;
+    entry.ProjectID = entry_project_id;
+    entry.Job = 0;
+    strcpy(entry.HoursAddedDate, "NULL");
+    strcpy(entry.ClockOutTime, "NULL");
+
+    char *timeStr = _TimeSlime_Time2Str(time);
+    strcpy(entry.ClockInTime, timeStr);
+    free(timeStr);
+
+    int nested;
+    TIMESLIME_STATUS_t status = _TimeSlime_BeginWrite(&nested);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_QueryInt("SELECT COUNT(*) FROM TimeSheet WHERE " __TS_QRY_GET_OPEN_SESSION, &open);
+    if (status == TIMESLIME_OK && open > 0)
+        status = TIMESLIME_ALREADY_CLOCKED_IN;
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_InsertEntry(&entry);
+
+    return _TimeSlime_EndWrite(nested, status);
+}
+
+/**
+ * Closes the last open clock session
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_ClockOut(TIMESLIME_DATETIME_t time)
+{
+    // Close the last open session in place
+    char sql[1000];
+    char *timeStr = _TimeSlime_Time2Str(time);
+    sprintf(sql,    "UPDATE TimeSheet " \
+                    "SET ClockOutTime = %s, LastUpdateTime = DATETIME('now', 'localtime') " \
+                    "WHERE ID = (SELECT MAX(ID) FROM TimeSheet WHERE " __TS_QRY_GET_OPEN_SESSION ")",
+            timeStr
+        );
+    free(timeStr);
+
+    int affected = 0;
+    TIMESLIME_STATUS_t status = _TimeSlime_ExecuteChange(sql, &affected);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    // Nothing to close
+    if (affected == 0)
+        return TIMESLIME_NOT_CLOCKED_IN;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Finds the open clock session, if there is one
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_GetOpenSession(TIMESLIME_ENTRY_t *out, int *found)
+{
+    TIMESLIME_ENTRIES_t *entries;
+
+    *found = 0;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_SelectEntries(0, __TS_QRY_GET_OPEN_SESSION);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    if (number_of_results == 0)
+        return TIMESLIME_OK;
+
+    status = _TimeSlime_BuildEntries(&entries);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    *out = entries->Entries[entries->NumberOfEntries - 1];
+    *found = 1;
+
+    TimeSlime_FreeEntries(&entries);
+    return TIMESLIME_OK;
+}
+
+/**
+ * Sums the hours worked per day in a date range
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out)
+{
+    int i;
+    char source[(TIMESLIME_MAX_ATTACHED + 1) * 400];
+    char sql[(TIMESLIME_MAX_ATTACHED + 1) * 400 + 1000];
+
+    // Time sheet, or the union of it and every attached file holding dates in the range
+    _TimeSlime_BuildReportSource(start, end, source);
+
+    char *startDate = _TimeSlime_Date2Str(start);
+    char *endDate = _TimeSlime_Date2Str(end);
 
     // Get sum of all hours based on day in the date range
     // All we care about is the TotalHours and TimeSheetDate columns
@@ -238,230 +2799,2803 @@ TIMESLIME_STATUS_t TimeSlime_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t
                     "ID, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, " \
                     "SUM(case when HoursAdded <> 0.0 then HoursAdded else ((JULIANDAY(ClockOutTime) - JULIANDAY(ClockInTime)) * 24) end) AS TotalHours, " \
                     "case when HoursAddedDate IS NOT NULL then DATE(HoursAddedDate) else DATE(ClockInTime) end AS TimeSheetDate " \
-                "FROM TimeSheet " \
+                "FROM %s " \
                 "WHERE (%s) AND (TimeSheetDate >= %s AND TimeSheetDate <= %s) " \
                 "GROUP BY TimeSheetDate " \
                 "ORDER BY TimeSheetDate ASC",
+            source,
             __TS_QRY_GET_ALL_ENTIRES,
             startDate,
             endDate
         );
 
     free(startDate);
-    startDate = NULL;
+    startDate = NULL;
+    free(endDate);
+    endDate = NULL;
+
+    number_of_results = 0;
+    TIMESLIME_STATUS_t result = _TimeSlime_ExecuteQuery(sql, 1);
+    if (result != TIMESLIME_OK)
+        return result;
+
+    // Generate report
+    TIMESLIME_REPORT_t *report = (TIMESLIME_REPORT_t*)malloc(sizeof(TIMESLIME_REPORT_t) + (number_of_results * sizeof(TIMESLIME_REPORT_ENTRY_t)));
+    if (report == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    // Summed in double precision, a float total drifts over long ranges
+    double total = 0;
+    report->NumberOfEntries = number_of_results;
+    for (i = 0; i < number_of_results; i++)
+    {
+        // Build report entries
+        report->Entries[i].Hours = database_results[i]->TotalHours;
+        total += report->Entries[i].Hours;
+        strcpy(report->Entries[i].Date, database_results[i]->TimeSheetDate);
+    }
+    report->TotalHours = (float)total;
+
+    *out = report;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Streams entries matching a filter to a callback, in ID order
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sqlite_Iterate(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata)
+{
+    char where[1000];
+    char sql[2000];
+    TIMESLIME_ITERATOR_t iterator = { callback, userdata };
+
+    TIMESLIME_STATUS_t status = _TimeSlime_FilterToSql(filter, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    sprintf(sql, "SELECT " __TS_QRY_ENTRY_COLUMNS "FROM TimeSheet WHERE %s ORDER BY ID ASC", where);
+
+    int rc = sqlite3_exec(db, sql, _TIMESLIME_SQLITE_ENTRY_CALLBACK, &iterator, &db_error);
+    if (rc != SQLITE_OK && rc != SQLITE_ABORT)
+        return TIMESLIME_SQLITE_ERROR;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Opens the append-only log backend, replaying the log to rebuild its state
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Open(char directory[])
+{
+    log_file = NULL;
+    log_days = NULL;
+    log_number_of_days = 0;
+    log_days_size = 0;
+    log_next_id = 1;
+    log_open_id = 0;
+    log_end_offset = 0;
+    log_unsynced = 0;
+    log_lock_depth = 0;
+    log_last_sync = time(NULL);
+    _TimeSlime_ApplySettings();
+
+    log_file_path = malloc((strlen(directory) + 2 + strlen(TIMESLIME_LOG_FILE_NAME)) * sizeof(char)); /* + 2 for the slash and terminator */
+    if (log_file_path == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    sprintf(log_file_path, "%s%s%s", directory, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_LOG_FILE_NAME);
+
+    log_file = fopen(log_file_path, "a+b");
+    if (log_file == NULL)
+        return TIMESLIME_STORAGE_ERROR;
+
+    // Taking the lock replays the whole log, as nothing has been read yet
+    return _TimeSlime_Log_End(_TimeSlime_Log_Begin());
+}
+
+/**
+ * Syncs and closes the log backend
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Close(void)
+{
+    TIMESLIME_STATUS_t status = TIMESLIME_OK;
+
+    if (log_file != NULL)
+    {
+        status = _TimeSlime_Log_Sync();
+        fclose(log_file);
+        log_file = NULL;
+    }
+
+    if (log_file_path != NULL)
+    {
+        free(log_file_path);
+        log_file_path = NULL;
+    }
+
+    if (log_days != NULL)
+    {
+        free(log_days);
+        log_days = NULL;
+    }
+
+    return status;
+}
+
+/**
+ * Appends an added hours record
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_AddHours(float hours, TIMESLIME_DATE_t date)
+{
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    TIMESLIME_LOG_RECORD_t record = { 0 };
+    record.Type = _TIMESLIME_LOG_HOURS;
+    record.ID = log_next_id;
+    record.Hours = hours;
+    record.Time = _TimeSlime_DateToDays(date) * _TIMESLIME_SECONDS_PER_DAY;
+
+    return _TimeSlime_Log_End(_TimeSlime_Log_Append(&record));
+}
+
+/**
+ * Appends a clock in record
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_ClockIn(TIMESLIME_DATETIME_t time)
+{
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    if (log_open_id != 0)
+        return _TimeSlime_Log_End(TIMESLIME_ALREADY_CLOCKED_IN);
+
+    TIMESLIME_LOG_RECORD_t record = { 0 };
+    record.Type = _TIMESLIME_LOG_CLOCK_IN;
+    record.ID = log_next_id;
+    record.Time = _TimeSlime_TimeToSeconds(time);
+
+    return _TimeSlime_Log_End(_TimeSlime_Log_Append(&record));
+}
+
+/**
+ * Appends a clock out record for the open session
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_ClockOut(TIMESLIME_DATETIME_t time)
+{
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    if (log_open_id == 0)
+        return _TimeSlime_Log_End(TIMESLIME_NOT_CLOCKED_IN);
+
+    TIMESLIME_LOG_RECORD_t record = { 0 };
+    record.Type = _TIMESLIME_LOG_CLOCK_OUT;
+    record.ID = log_open_id;
+    record.Time = _TimeSlime_TimeToSeconds(time);
+
+    return _TimeSlime_Log_End(_TimeSlime_Log_Append(&record));
+}
+
+/**
+ * The open session is known from the replay, only records other processes appended are read
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_GetOpenSession(TIMESLIME_ENTRY_t *out, int *found)
+{
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    *found = (log_open_id != 0);
+    if (*found)
+        _TimeSlime_Log_ToEntry(log_open_id, 0, log_open_time, 0, 0, out);
+
+    return _TimeSlime_Log_End(TIMESLIME_OK);
+}
+
+/**
+ * Builds a report from the per day totals, reading only records other processes appended
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out)
+{
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    int64_t startDay = _TimeSlime_DateToDays(start);
+    int64_t endDay = _TimeSlime_DateToDays(end);
+    int first = _TimeSlime_Log_FindDay(startDay);
+    int last = first;
+    int i;
+
+    while (last < log_number_of_days && log_days[last].Day <= endDay)
+        last++;
+
+    TIMESLIME_REPORT_t *report = (TIMESLIME_REPORT_t*)malloc(sizeof(TIMESLIME_REPORT_t) + ((last - first) * sizeof(TIMESLIME_REPORT_ENTRY_t)));
+    if (report == NULL)
+        return _TimeSlime_Log_End(TIMESLIME_UNKOWN_ERROR);
+
+    double total = 0;
+    report->NumberOfEntries = last - first;
+    for (i = first; i < last; i++)
+    {
+        report->Entries[i - first].Hours = log_days[i].Hours;
+        total += report->Entries[i - first].Hours;
+        _TimeSlime_FormatDays(log_days[i].Day, report->Entries[i - first].Date);
+    }
+    report->TotalHours = (float)total;
+
+    *out = report;
+
+    return _TimeSlime_Log_End(TIMESLIME_OK);
+}
+
+/**
+ * Streams entries matching a filter to a callback. Reading starts at the first record
+ * of the earliest day in the filter, found through the per day index. Sessions are
+ * passed to the callback when they are clocked out, an open session comes last.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Iterate(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata)
+{
+    TIMESLIME_LOG_RECORD_t record;
+    TIMESLIME_ENTRY_t entry;
+    int64_t startDay = _TIMESLIME_IS_DATE_ANY(filter.start) ? INT32_MIN : _TimeSlime_DateToDays(filter.start);
+    int64_t endDay = _TIMESLIME_IS_DATE_ANY(filter.end) ? INT32_MAX : _TimeSlime_DateToDays(filter.end);
+    long offset = log_end_offset;
+    int pendingID = 0;
+    int64_t pendingTime = 0;
+    int64_t day;
+    int i;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+        return status;
+
+    for (i = _TimeSlime_Log_FindDay(startDay); i < log_number_of_days && log_days[i].Day <= endDay; i++)
+    {
+        if (log_days[i].FirstOffset < offset)
+            offset = log_days[i].FirstOffset;
+    }
+
+    if (log_open_id != 0 && log_open_offset < offset)
+        offset = log_open_offset;
+
+    if (fseek(log_file, offset, SEEK_SET) != 0)
+        return _TimeSlime_Log_End(TIMESLIME_STORAGE_ERROR);
+
+    for (; offset < log_end_offset; offset += sizeof(TIMESLIME_LOG_RECORD_t))
+    {
+        if (fread(&record, sizeof(TIMESLIME_LOG_RECORD_t), 1, log_file) != 1)
+            return _TimeSlime_Log_End(TIMESLIME_STORAGE_ERROR);
+
+        if (record.Type == _TIMESLIME_LOG_CLOCK_IN)
+        {
+            pendingID = record.ID;
+            pendingTime = record.Time;
+            continue;
+        }
+
+        if (record.Type == _TIMESLIME_LOG_CLOCK_OUT)
+        {
+            if (record.ID != pendingID)
+                continue;
+            _TimeSlime_Log_ToEntry(pendingID, 0, pendingTime, record.Time, 0, &entry);
+            day = _TIMESLIME_FLOOR_DIV(pendingTime, _TIMESLIME_SECONDS_PER_DAY);
+            pendingID = 0;
+        }
+        else
+        {
+            _TimeSlime_Log_ToEntry(record.ID, 1, record.Time, 0, record.Hours, &entry);
+            day = _TIMESLIME_FLOOR_DIV(record.Time, _TIMESLIME_SECONDS_PER_DAY);
+        }
+
+        if (_TimeSlime_Log_Matches(filter, &entry, day, startDay, endDay) && callback(&entry, userdata) != 0)
+            return _TimeSlime_Log_End(TIMESLIME_OK);
+    }
+
+    if (pendingID != 0)
+    {
+        _TimeSlime_Log_ToEntry(pendingID, 0, pendingTime, 0, 0, &entry);
+        day = _TIMESLIME_FLOOR_DIV(pendingTime, _TIMESLIME_SECONDS_PER_DAY);
+        if (_TimeSlime_Log_Matches(filter, &entry, day, startDay, endDay))
+            callback(&entry, userdata);
+    }
+
+    return _TimeSlime_Log_End(TIMESLIME_OK);
+}
+
+/**
+ * Writes a record to the end of the log and applies it to the in memory state.
+ * Every record is flushed to the OS, but only synced to disk in batches.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Append(TIMESLIME_LOG_RECORD_t *record)
+{
+    record->Magic = _TIMESLIME_LOG_MAGIC;
+    record->Checksum = _TimeSlime_Log_Checksum(record);
+
+    if (fseek(log_file, 0, SEEK_END) != 0)
+        return TIMESLIME_STORAGE_ERROR;
+
+    if (fwrite(record, sizeof(TIMESLIME_LOG_RECORD_t), 1, log_file) != 1 || fflush(log_file) != 0)
+        return TIMESLIME_STORAGE_ERROR;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Apply(record, log_end_offset);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    log_end_offset += sizeof(TIMESLIME_LOG_RECORD_t);
+
+    log_unsynced++;
+    if (log_unsynced >= log_sync_batch || time(NULL) - log_last_sync >= TIMESLIME_LOG_SYNC_INTERVAL)
+        return _TimeSlime_Log_Sync();
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Takes an exclusive lock on the log file, so other processes can not append while this one
+ * reads or writes, then applies whatever they appended since this process last held it.
+ * The lock can be taken again while held, each _TimeSlime_Log_Begin needs a _TimeSlime_Log_End.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Begin(void)
+{
+    if (log_lock_depth++ > 0)
+        return TIMESLIME_OK;
+
+    int fd = _TIMESLIME_FILENO(log_file);
+#ifdef _WIN32
+    OVERLAPPED overlapped = { 0 };
+    if (!LockFileEx((HANDLE)_get_osfhandle(fd), LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped))
+    {
+        log_lock_depth = 0;
+        return TIMESLIME_STORAGE_ERROR;
+    }
+#else
+    struct flock lock = { 0 };
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;   /* Start and length of 0 cover the whole file, however long it grows */
+    while (fcntl(fd, F_SETLKW, &lock) != 0)
+    {
+        if (errno != EINTR)
+        {
+            log_lock_depth = 0;
+            return TIMESLIME_STORAGE_ERROR;
+        }
+    }
+#endif
+
+    TIMESLIME_STATUS_t status = _TimeSlime_Log_Replay();
+    if (status != TIMESLIME_OK)
+        return _TimeSlime_Log_End(status);
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Lets go of the lock taken by _TimeSlime_Log_Begin and passes status through
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_End(TIMESLIME_STATUS_t status)
+{
+    if (--log_lock_depth > 0)
+        return status;
+
+    // Appended records must reach the OS before another process reads them
+    fflush(log_file);
+
+    int fd = _TIMESLIME_FILENO(log_file);
+#ifdef _WIN32
+    OVERLAPPED overlapped = { 0 };
+    UnlockFileEx((HANDLE)_get_osfhandle(fd), 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+    struct flock lock = { 0 };
+    lock.l_type = F_UNLCK;
+    lock.l_whence = SEEK_SET;
+    fcntl(fd, F_SETLK, &lock);
+#endif
+
+    return status;
+}
+
+/**
+ * Applies the records after the last one this process read, which is the whole log on open.
+ * A short record at the very end was torn by a crash mid-write and is cut off, which is safe
+ * as no other process can be writing it while the lock is held. A damaged full record is not
+ * cut off, whatever follows it would be lost, TIMESLIME_LOG_CORRUPT is returned instead.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Replay(void)
+{
+    TIMESLIME_LOG_RECORD_t record;
+    size_t read;
+
+    if (fseek(log_file, log_end_offset, SEEK_SET) != 0)
+        return TIMESLIME_STORAGE_ERROR;
+
+    while ((read = fread(&record, 1, sizeof(TIMESLIME_LOG_RECORD_t), log_file)) == sizeof(TIMESLIME_LOG_RECORD_t))
+    {
+        if (record.Magic != _TIMESLIME_LOG_MAGIC || record.Checksum != _TimeSlime_Log_Checksum(&record))
+            return TIMESLIME_LOG_CORRUPT;
+
+        if (_TimeSlime_Log_Apply(&record, log_end_offset) != TIMESLIME_OK)
+            return TIMESLIME_UNKOWN_ERROR;
+
+        log_end_offset += sizeof(TIMESLIME_LOG_RECORD_t);
+    }
+
+    if (ferror(log_file))
+        return TIMESLIME_STORAGE_ERROR;
+
+    if (read > 0 && _TIMESLIME_FTRUNCATE(_TIMESLIME_FILENO(log_file), log_end_offset) != 0)
+        return TIMESLIME_STORAGE_ERROR;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Forces appended records to disk
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Sync(void)
+{
+    if (log_unsynced == 0)
+        return TIMESLIME_OK;
+
+    if (fflush(log_file) != 0 || _TIMESLIME_FSYNC(_TIMESLIME_FILENO(log_file)) != 0)
+        return TIMESLIME_STORAGE_ERROR;
+
+    log_unsynced = 0;
+    log_last_sync = time(NULL);
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Updates the open session and per day totals for a record at offset in the log
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Log_Apply(TIMESLIME_LOG_RECORD_t *record, long offset)
+{
+    TIMESLIME_LOG_DAY_t *day;
+
+    if (record->ID >= log_next_id)
+        log_next_id = record->ID + 1;
+
+    switch (record->Type)
+    {
+        case _TIMESLIME_LOG_HOURS:
+            day = _TimeSlime_Log_GetDay(_TIMESLIME_FLOOR_DIV(record->Time, _TIMESLIME_SECONDS_PER_DAY));
+            if (day == NULL)
+                return TIMESLIME_UNKOWN_ERROR;
+            day->Hours += record->Hours;
+            if (offset < day->FirstOffset)
+                day->FirstOffset = offset;
+            break;
+
+        case _TIMESLIME_LOG_CLOCK_IN:
+            log_open_id = record->ID;
+            log_open_time = record->Time;
+            log_open_offset = offset;
+            break;
+
+        case _TIMESLIME_LOG_CLOCK_OUT:
+            if (record->ID != log_open_id)
+                break;
+            day = _TimeSlime_Log_GetDay(_TIMESLIME_FLOOR_DIV(log_open_time, _TIMESLIME_SECONDS_PER_DAY));
+            if (day == NULL)
+                return TIMESLIME_UNKOWN_ERROR;
+            day->Hours += (record->Time - log_open_time) / 3600.0;
+            if (log_open_offset < day->FirstOffset)
+                day->FirstOffset = log_open_offset;
+            log_open_id = 0;
+            break;
+    }
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Index of the first day in the per day index that is on or after day
+ */
+static int _TimeSlime_Log_FindDay(int64_t day)
+{
+    int low = 0;
+    int high = log_number_of_days;
+
+    // Records nearly always land on the last day, so check that before searching
+    if (log_number_of_days > 0 && log_days[log_number_of_days - 1].Day < day)
+        return log_number_of_days;
+
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (log_days[middle].Day < day)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/**
+ * Gets a day from the per day index, inserting it if needed
+ */
+static TIMESLIME_LOG_DAY_t* _TimeSlime_Log_GetDay(int64_t day)
+{
+    int i = _TimeSlime_Log_FindDay(day);
+    if (i < log_number_of_days && log_days[i].Day == day)
+        return &log_days[i];
+
+    // Increase index size if needed
+    if (log_number_of_days >= log_days_size)
+    {
+        int new_size = (log_days_size == 0) ? TIMESLIME_DEFAULT_RESULT_LIMIT : log_days_size * 2;
+        TIMESLIME_LOG_DAY_t *new_days = (TIMESLIME_LOG_DAY_t*)realloc(log_days, new_size * sizeof(TIMESLIME_LOG_DAY_t));
+        if (new_days == NULL)
+            return NULL;
+
+        log_days = new_days;
+        log_days_size = new_size;
+    }
+
+    memmove(&log_days[i + 1], &log_days[i], (log_number_of_days - i) * sizeof(TIMESLIME_LOG_DAY_t));
+    log_number_of_days++;
+
+    log_days[i].Day = day;
+    log_days[i].Hours = 0;
+    log_days[i].FirstOffset = LONG_MAX;
+
+    return &log_days[i];
+}
+
+/**
+ * Checks a log entry against a filter
+ */
+static int _TimeSlime_Log_Matches(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_t *entry, int64_t day, int64_t startDay, int64_t endDay)
+{
+    int isHours = (strcmp(entry->HoursAddedDate, "NULL") != 0);
+    int isOpen = !isHours && (strcmp(entry->ClockOutTime, "NULL") == 0);
+
+    if (filter.kind == TIMESLIME_ENTRY_KIND_CLOCK && isHours)
+        return 0;
+    if (filter.kind == TIMESLIME_ENTRY_KIND_HOURS && !isHours)
+        return 0;
+    if (filter.state == TIMESLIME_ENTRY_STATE_OPEN && !isOpen)
+        return 0;
+    if (filter.state == TIMESLIME_ENTRY_STATE_CLOSED && isOpen)
+        return 0;
+
+    return day >= startDay && day <= endDay;
+}
+
+/**
+ * Fills in an entry from log record values, a clockOut of 0 means the session is still open
+ */
+static void _TimeSlime_Log_ToEntry(int id, int isHours, int64_t clockIn, int64_t clockOut, float hours, TIMESLIME_ENTRY_t *entry)
+{
+    entry->ID = id;
+    entry->HoursAdded = isHours ? hours : 0;
+    strcpy(entry->HoursAddedDate, "NULL");
+    strcpy(entry->ClockInTime, "NULL");
+    strcpy(entry->ClockOutTime, "NULL");
+    _TimeSlime_FormatDays(_TIMESLIME_FLOOR_DIV(clockIn, _TIMESLIME_SECONDS_PER_DAY), entry->TimeSheetDate);
+
+    if (isHours)
+    {
+        entry->Hours = hours;
+        strcpy(entry->HoursAddedDate, entry->TimeSheetDate);
+        return;
+    }
+
+    _TimeSlime_FormatSeconds(clockIn, entry->ClockInTime);
+    entry->Hours = 0;
+    if (clockOut != 0)
+    {
+        _TimeSlime_FormatSeconds(clockOut, entry->ClockOutTime);
+        entry->Hours = (clockOut - clockIn) / 3600.0;
+    }
+}
+
+/**
+ * FNV-1a over everything in a record but the checksum itself
+ */
+static uint32_t _TimeSlime_Log_Checksum(TIMESLIME_LOG_RECORD_t *record)
+{
+    unsigned char *bytes = (unsigned char*)record;
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < offsetof(TIMESLIME_LOG_RECORD_t, Checksum); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Compacts the clock sessions of the days in [startDay, endDay) in one transaction
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CompactChunk(int64_t startDay, int64_t endDay, TIMESLIME_COMPACTION_t *out)
+{
+    char range[500];
+    char sql[1500];
+    char startDate[TIMESLIME_DATETIME_STR_LENGTH];
+    char endDate[TIMESLIME_DATETIME_STR_LENGTH];
+
+    _TimeSlime_FormatDays(startDay, startDate);
+    _TimeSlime_FormatDays(endDay, endDate);
+    sprintf(range, __TS_QRY_GET_COMPLTED_CLOCK_ENTRIES " AND " __TS_QRY_ENTRY_DATE " >= '%s' AND " __TS_QRY_ENTRY_DATE " < '%s'", startDate, endDate);
+
+    int nested;
+    TIMESLIME_STATUS_t status = _TimeSlime_BeginWrite(&nested);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    // Summed in SQL so the totals keep full precision, and the same way reports count
+    // each entry, so an entry with both added hours and clock times keeps its hours
+    sprintf(sql,    "INSERT INTO TimeSheet (HoursAdded, HoursAddedDate, ProjectID) " \
+                    "SELECT SUM(" __TS_QRY_ENTRY_HOURS ") AS Hours, " __TS_QRY_ENTRY_DATE " AS Day, ProjectID " \
+                    "FROM TimeSheet WHERE %s " \
+                    "GROUP BY Day, ProjectID HAVING Hours <> 0.0",
+            range
+        );
+
+    status = _TimeSlime_ExecuteQuery(sql, 0);
+    int days = sqlite3_changes(db);
+
+    sprintf(sql, "DELETE FROM TimeSheet WHERE %s", range);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+    int sessions = sqlite3_changes(db);
+
+    status = _TimeSlime_EndWrite(nested, status);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    out->DaysCompacted += days;
+    out->SessionsCompacted += sessions;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Reads up to limit entries after cursor and works out the problems with each.
+ * Only the newest open session is allowed, and a clock session is a duplicate when an
+ * earlier one on the same date (found through the entry date index) is identical. Added
+ * hours are never duplicates, adding the same hours twice to a day is a normal thing to do.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_VerifyChunk(int cursor, int limit, TIMESLIME_VERIFY_CHUNK_t *out)
+{
+    char sql[2500];
+
+    out->NumberOfEntries = 0;
+
+    // Jobs run side by side, only an older open session of the same job (or the plain clock) is left over
+    sprintf(sql,    "SELECT Chunk.ID, " \
+                        "(CASE WHEN Chunk.ClockInTime IS NOT NULL AND Chunk.ClockOutTime IS NULL AND EXISTS (SELECT 1 FROM TimeSheet WHERE Job = Chunk.Job " \
+                            "AND (Chunk.Job = 0 OR ProjectID IS Chunk.ProjectID) AND ID > Chunk.ID AND " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES ") THEN %d ELSE 0 END) | " \
+                        "(CASE WHEN JULIANDAY(Chunk.ClockOutTime) < JULIANDAY(Chunk.ClockInTime) THEN %d ELSE 0 END) | " \
+                        "(CASE WHEN JULIANDAY(Chunk.ClockOutTime) - JULIANDAY(Chunk.ClockInTime) > 1.0 THEN %d ELSE 0 END) | " \
+                        "(CASE WHEN Chunk.ClockInTime IS NOT NULL AND (Chunk.HoursAdded <> 0.0 OR Chunk.HoursAddedDate IS NOT NULL) THEN %d ELSE 0 END) | " \
+                        "(CASE WHEN Chunk.ClockInTime IS NOT NULL AND EXISTS (SELECT 1 FROM TimeSheet WHERE " __TS_QRY_ENTRY_DATE " = Chunk.Day AND ID < Chunk.ID " \
+                            "AND HoursAdded = Chunk.HoursAdded AND HoursAddedDate IS Chunk.HoursAddedDate " \
+                            "AND ClockInTime IS Chunk.ClockInTime AND ClockOutTime IS Chunk.ClockOutTime AND ProjectID IS Chunk.ProjectID) THEN %d ELSE 0 END) " \
+                    "FROM (SELECT ID, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, ProjectID, Job, " __TS_QRY_ENTRY_DATE " AS Day " \
+                        "FROM TimeSheet WHERE ID > %d ORDER BY ID LIMIT %d) Chunk " \
+                    "ORDER BY Chunk.ID",
+            TIMESLIME_PROBLEM_OPEN,
+            TIMESLIME_PROBLEM_NEGATIVE,
+            TIMESLIME_PROBLEM_TOO_LONG,
+            TIMESLIME_PROBLEM_MIXED,
+            TIMESLIME_PROBLEM_DUPLICATE,
+            cursor,
+            limit
+        );
+
+    return _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_VERIFY_CALLBACK, out, &db_error));
+}
+
+/**
+ * Reads the rest of one changeset record after its flags, returns TIMESLIME_INVALID_CHANGESET when it is cut short
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sync_Read(FILE *file, int flags, int sender, TIMESLIME_SYNC_RECORD_t *out)
+{
+    uint64_t value = (uint64_t)sender;
+
+    memset(out, 0, sizeof(TIMESLIME_SYNC_RECORD_t));
+    out->Deleted = flags & _TIMESLIME_SYNC_DELETED;
+    out->HasDate = flags & _TIMESLIME_SYNC_HOURS_DATE;
+    out->HasClockIn = flags & _TIMESLIME_SYNC_CLOCK_IN;
+    out->HasClockOut = flags & _TIMESLIME_SYNC_CLOCK_OUT;
+    out->Job = (flags & _TIMESLIME_SYNC_JOB) ? 1 : 0;
+
+    if ((flags & _TIMESLIME_SYNC_FOREIGN) && !_TimeSlime_Sync_GetVarint(file, &value))
+        return TIMESLIME_INVALID_CHANGESET;
+    if (value == 0 || value > INT32_MAX)
+        return TIMESLIME_INVALID_CHANGESET;
+    out->Origin = (int)value;
+
+    if (!_TimeSlime_Sync_GetVarint(file, &value))
+        return TIMESLIME_INVALID_CHANGESET;
+    out->OriginID = (long long)value;
+
+    if (out->Deleted)
+        return TIMESLIME_OK;
+
+    if (!_TimeSlime_Sync_GetSigned(file, &out->HoursMantissa) || !_TimeSlime_Sync_GetVarint(file, &value) ||
+        value > _TIMESLIME_SYNC_MAX_SHIFT ||
+        (out->HasDate && !_TimeSlime_Sync_GetSigned(file, &out->Days)) ||
+        (out->HasClockIn && !_TimeSlime_Sync_GetSigned(file, &out->ClockIn)) ||
+        (out->HasClockOut && !_TimeSlime_Sync_GetSigned(file, &out->ClockOut)) ||
+        !_TimeSlime_Sync_GetSigned(file, &out->LastUpdate))
+        return TIMESLIME_INVALID_CHANGESET;
+
+    out->HoursShift = (int)value;
+    if (out->HasClockIn && out->HasClockOut)
+        out->ClockOut += out->ClockIn;
+
+    if (flags & _TIMESLIME_SYNC_PROJECT)
+    {
+        if (!_TimeSlime_Sync_GetVarint(file, &value) || value == 0 || value >= TIMESLIME_PROJECT_STR_LENGTH ||
+            fread(out->Project, 1, (size_t)value, file) != (size_t)value)
+            return TIMESLIME_INVALID_CHANGESET;
+        out->Project[value] = '\0';
+    }
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Applies one imported change. The entry is found by its origin through a unique index, or by its
+ * own ID when it was made here. A change older than the last change made here is skipped, and an
+ * entry deleted here stays deleted. Change times are compared in UTC, as machines may be in
+ * different time zones, and kept in local time like every other change.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Sync_Apply(TIMESLIME_SYNC_RECORD_t *record, int machine, TIMESLIME_SYNC_t *out)
+{
+    char sql[1000];
+    char hours[100], hoursDate[64], clockIn[64], clockOut[64];
+    int id = 0;
+    int found = 0;
+
+    if (record->Origin == machine)
+        sprintf(sql, "SELECT ID FROM TimeSheet WHERE ID = %lld AND Origin IS NULL", record->OriginID);
+    else
+        sprintf(sql, "SELECT ID FROM TimeSheet WHERE Origin = %d AND OriginID = %lld", record->Origin, record->OriginID);
+
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt(sql, &id);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    if (record->Deleted)
+    {
+        if (id == 0)
+            return TIMESLIME_OK;
+
+        sprintf(sql, "DELETE FROM TimeSheet WHERE ID = %d", id);
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+        if (status == TIMESLIME_OK)
+            out->Applied++;
+        return status;
+    }
+
+    // Changed at the same second is taken as the same change, seen before
+    if (id != 0)
+    {
+        sprintf(sql,    "SELECT CASE WHEN CAST(STRFTIME('%%s', LastUpdateTime, 'utc') AS INTEGER) > %lld THEN 2 " \
+                            "WHEN CAST(STRFTIME('%%s', LastUpdateTime, 'utc') AS INTEGER) = %lld THEN 1 ELSE 0 END " \
+                        "FROM TimeSheet WHERE ID = %d",
+                record->LastUpdate, record->LastUpdate, id);
+        status = _TimeSlime_QueryInt(sql, &found);
+        if (status == TIMESLIME_OK && found == 2)
+            out->Conflicts++;
+        if (status != TIMESLIME_OK || found > 0)
+            return status;
+    }
+    else {
+        // IDs are never reused, so a missing entry of this machine was deleted here
+        if (record->Origin == machine)
+            return TIMESLIME_OK;
+
+        sprintf(sql, "SELECT COUNT(*) FROM TimeSheetChanges WHERE Origin = %d AND OriginID = %lld AND Deleted = 1", record->Origin, record->OriginID);
+        status = _TimeSlime_QueryInt(sql, &found);
+        if (status != TIMESLIME_OK || found)
+            return status;
+    }
+
+    int projectID = 0;
+    status = _TimeSlime_ProjectID((record->Project[0] != '\0') ? record->Project : NULL, &projectID);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    // Dividing by powers of two is exact, so the hours come out as the same double they left as
+    sprintf(hours, "(%lld * 1.0 / %lld / %lld)",
+            record->HoursMantissa,
+            1LL << ((record->HoursShift > 62) ? 62 : record->HoursShift),
+            1LL << ((record->HoursShift > 62) ? record->HoursShift - 62 : 0)
+        );
+
+    strcpy(hoursDate, "NULL");
+    strcpy(clockIn, "NULL");
+    strcpy(clockOut, "NULL");
+    if (record->HasDate)
+        sprintf(hoursDate, "DATE(%lld, 'unixepoch')", record->Days * 86400);
+    if (record->HasClockIn)
+        sprintf(clockIn, "DATETIME(%lld, 'unixepoch')", record->ClockIn);
+    if (record->HasClockOut)
+        sprintf(clockOut, "DATETIME(%lld, 'unixepoch')", record->ClockOut);
+
+    if (id != 0)
+        sprintf(sql,    "UPDATE TimeSheet " \
+                        "SET HoursAdded = %s, HoursAddedDate = %s, ClockInTime = %s, ClockOutTime = %s, " \
+                            "ProjectID = NULLIF(%d, 0), Job = %d, LastUpdateTime = DATETIME(%lld, 'unixepoch', 'localtime') " \
+                        "WHERE ID = %d",
+                hours, hoursDate, clockIn, clockOut, projectID, record->Job, record->LastUpdate, id);
+    else
+        sprintf(sql,    "INSERT INTO TimeSheet " \
+                        "(HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, ProjectID, Job, LastUpdateTime, Origin, OriginID) " \
+                        "VALUES " \
+                        "(%s, %s, %s, %s, NULLIF(%d, 0), %d, DATETIME(%lld, 'unixepoch', 'localtime'), %d, %lld)",
+                hours, hoursDate, clockIn, clockOut, projectID, record->Job, record->LastUpdate, record->Origin, record->OriginID);
+
+    status = _TimeSlime_ExecuteQuery(sql, 0);
+    if (status == TIMESLIME_OK)
+        out->Applied++;
+
+    return status;
+}
+
+/**
+ * Writes an unsigned number 7 bits at a time, low bits first, so small numbers take one byte
+ */
+static void _TimeSlime_Sync_PutVarint(FILE *file, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)((value & 0x7F) | 0x80), file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+/**
+ * Writes a signed number as a varint, folded so small negative numbers stay small
+ */
+static void _TimeSlime_Sync_PutSigned(FILE *file, int64_t value)
+{
+    _TimeSlime_Sync_PutVarint(file, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/**
+ * Reads a varint, returns 0 at the end of the file or when it is too long
+ */
+static int _TimeSlime_Sync_GetVarint(FILE *file, uint64_t *out)
+{
+    int shift;
+    *out = 0;
+
+    for (shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(file);
+        if (c == EOF)
+            return 0;
+
+        *out |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Reads a number written by _TimeSlime_Sync_PutSigned
+ */
+static int _TimeSlime_Sync_GetSigned(FILE *file, long long *out)
+{
+    uint64_t value;
+    if (!_TimeSlime_Sync_GetVarint(file, &value))
+        return 0;
+
+    *out = (long long)((value >> 1) ^ (~(value & 1) + 1));
+    return 1;
+}
+
+/**
+ * Splits hours into an integer and the power of two it is divided by, both exact. Doubling is
+ * exact too, and stops as soon as no fraction is left, so whole and half hours stay a byte or two.
+ */
+static void _TimeSlime_Sync_SplitHours(double hours, long long *mantissa, int *shift)
+{
+    *shift = 0;
+    while ((double)(long long)hours != hours && *shift < _TIMESLIME_SYNC_MAX_SHIFT)
+    {
+        hours *= 2;
+        (*shift)++;
+    }
+
+    *mantissa = (long long)hours;
+}
+
+/**
+ * Fixes the problems of one entry, inside the transaction of its chunk
+ */
+static TIMESLIME_STATUS_t _TimeSlime_RepairEntry(int id, int problems)
+{
+    char sql[1000];
+    TIMESLIME_STATUS_t status = TIMESLIME_OK;
+
+    // Nothing else matters about a copy
+    if (problems & TIMESLIME_PROBLEM_DUPLICATE)
+    {
+        sprintf(sql, "DELETE FROM TimeSheet WHERE ID = %d", id);
+        return _TimeSlime_ExecuteQuery(sql, 0);
+    }
+
+    if (problems & TIMESLIME_PROBLEM_OPEN)
+    {
+        sprintf(sql,    "UPDATE TimeSheet SET ClockOutTime = ClockInTime, LastUpdateTime = DATETIME('now', 'localtime') " \
+                        "WHERE ID = %d AND " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES, id);
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+    }
+
+    if (status == TIMESLIME_OK && (problems & TIMESLIME_PROBLEM_NEGATIVE))
+    {
+        sprintf(sql,    "UPDATE TimeSheet SET ClockInTime = ClockOutTime, ClockOutTime = ClockInTime, LastUpdateTime = DATETIME('now', 'localtime') " \
+                        "WHERE ID = %d AND JULIANDAY(ClockOutTime) < JULIANDAY(ClockInTime)", id);
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+    }
+
+    // The clock times become an entry of their own, and the entry is dropped if no added hours are left
+    if (status == TIMESLIME_OK && (problems & TIMESLIME_PROBLEM_MIXED))
+    {
+        sprintf(sql,    "INSERT INTO TimeSheet (ClockInTime, ClockOutTime, ProjectID, Job) SELECT ClockInTime, ClockOutTime, ProjectID, Job FROM TimeSheet WHERE ID = %d AND ClockInTime IS NOT NULL; " \
+                        "UPDATE TimeSheet SET ClockInTime = NULL, ClockOutTime = NULL, LastUpdateTime = DATETIME('now', 'localtime') WHERE ID = %d; " \
+                        "DELETE FROM TimeSheet WHERE ID = %d AND NOT " __TS_QRY_GET_ADDED_HOURS,
+                id,
+                id,
+                id
+            );
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+    }
+
+    return status;
+}
+
+/**
+ * Reads a value the library keeps between runs, 0 when it was never set
+ */
+static TIMESLIME_STATUS_t _TimeSlime_GetState(char *name, int *out)
+{
+    char sql[200];
+    sprintf(sql, "SELECT Value FROM TimeSlimeState WHERE Name = '%s'", name);
+
+    *out = 0;
+    return _TimeSlime_QueryInt(sql, out);
+}
+
+/**
+ * Saves a value the library keeps between runs
+ */
+static TIMESLIME_STATUS_t _TimeSlime_SetState(char *name, int value)
+{
+    char sql[200];
+    sprintf(sql, "INSERT OR REPLACE INTO TimeSlimeState (Name, Value) VALUES ('%s', %d)", name, value);
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Looks up the ID of a project by name, adding it the first time it is used. NULL is no project.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_ProjectID(char *project, int *out)
+{
+    *out = 0;
+    if (project == NULL)
+        return TIMESLIME_OK;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    if (project[0] == '\0' || strlen(project) >= TIMESLIME_PROJECT_STR_LENGTH)
+        return TIMESLIME_INVALID_PROJECT;
+
+    char *select = sqlite3_mprintf("SELECT ID FROM Projects WHERE Name = %Q", project);
+    char *insert = sqlite3_mprintf("INSERT OR IGNORE INTO Projects (Name) VALUES (%Q)", project);
+    if (select == NULL || insert == NULL)
+    {
+        sqlite3_free(select);
+        sqlite3_free(insert);
+        return TIMESLIME_UNKOWN_ERROR;
+    }
+
+    // Only written the first time, another process may add the same name in between
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt(select, out);
+    if (status == TIMESLIME_OK && *out == 0)
+        status = _TimeSlime_ExecuteQuery(insert, 0);
+    if (status == TIMESLIME_OK && *out == 0)
+        status = _TimeSlime_QueryInt(select, out);
+
+    sqlite3_free(select);
+    sqlite3_free(insert);
+    return status;
+}
+
+/**
+ * Allocates an async request
+ */
+static TIMESLIME_ASYNC_REQUEST_t* _TimeSlime_Async_New(int operation, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata)
+{
+    TIMESLIME_ASYNC_REQUEST_t *request = (TIMESLIME_ASYNC_REQUEST_t*)calloc(1, sizeof(TIMESLIME_ASYNC_REQUEST_t));
+    if (request == NULL)
+        return NULL;
+
+    request->Operation = operation;
+    request->Callback = callback;
+    request->UserData = userdata;
+    return request;
+}
+
+/**
+ * Adds a request to the end of the worker's queue, it is freed when it can not be queued
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Async_Submit(TIMESLIME_ASYNC_REQUEST_t *request)
+{
+#ifndef _WIN32
+    pthread_mutex_lock(&async_lock);
+    if (!async_running || async_stopping)
+    {
+        pthread_mutex_unlock(&async_lock);
+        free(request);
+        return TIMESLIME_ASYNC_NOT_STARTED;
+    }
+
+    if (async_queue_last != NULL)
+        async_queue_last->Next = request;
+    else
+        async_queue = request;
+    async_queue_last = request;
+
+    pthread_cond_signal(&async_wake);
+    pthread_mutex_unlock(&async_lock);
+
+    return TIMESLIME_OK;
+#else
+    free(request);
+    return TIMESLIME_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Runs one request with the blocking function it stands for
+ */
+static void _TimeSlime_Async_Run(TIMESLIME_ASYNC_REQUEST_t *request)
+{
+    TIMESLIME_REPORT_t *report = NULL;
+
+    switch (request->Operation)
+    {
+        case _TIMESLIME_ASYNC_ADD_HOURS:
+            request->Status = TimeSlime_AddHours(request->Hours, request->Start);
+            break;
+        case _TIMESLIME_ASYNC_CLOCK_IN:
+            request->Status = TimeSlime_ClockIn(request->Time);
+            break;
+        case _TIMESLIME_ASYNC_CLOCK_OUT:
+            request->Status = TimeSlime_ClockOut(request->Time);
+            break;
+        case _TIMESLIME_ASYNC_REPORT:
+            request->Status = TimeSlime_GetReport(request->Start, request->End, &report);
+            if (request->Status == TIMESLIME_OK)
+                request->Result = report;
+            break;
+        default:
+            request->Status = TIMESLIME_UNKOWN_ERROR;
+    }
+}
+
+#ifndef _WIN32
+/**
+ * Worker thread, runs queued requests in order until stopped and the queue is empty
+ */
+static void* _TimeSlime_Async_Worker(void *ignoreMe)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&async_lock);
+        while (async_queue == NULL && !async_stopping)
+            pthread_cond_wait(&async_wake, &async_lock);
+
+        TIMESLIME_ASYNC_REQUEST_t *request = async_queue;
+        if (request == NULL)
+        {
+            pthread_mutex_unlock(&async_lock);
+            break;
+        }
+
+        async_queue = request->Next;
+        if (async_queue == NULL)
+            async_queue_last = NULL;
+        pthread_mutex_unlock(&async_lock);
+
+        request->Next = NULL;
+        _TimeSlime_Async_Run(request);
+
+        pthread_mutex_lock(&async_lock);
+        if (async_finished_last != NULL)
+            async_finished_last->Next = request;
+        else
+            async_finished = request;
+        async_finished_last = request;
+        pthread_mutex_unlock(&async_lock);
+
+        // Only fails when the pipe is full, and then it is readable already
+        if (write(async_pipe[1], "", 1) < 0)
+            continue;
+    }
+
+    return NULL;
+}
+#endif
+
+/**
+ * Starts the checkpoint thread when the database is in WAL mode. The WAL hook takes the
+ * place of SQLITE's own automatic checkpoint, so a commit never has to run a checkpoint
+ * itself; the thread runs them instead, on its own connection so readers and writers here
+ * carry on. A passive checkpoint runs once CheckpointPages pages are waiting, and once
+ * writes go quiet for TIMESLIME_CHECKPOINT_IDLE the WAL is checkpointed in full and truncated.
+ * Failing to start is not an error, checkpoints are then left to SQLITE as before.
+ */
+static void _TimeSlime_Checkpoint_Start(void)
+{
+#ifndef _WIN32
+    int wal = 0;
+    int threshold = (has_settings) ? settings.CheckpointPages : TIMESLIME_CHECKPOINT_PAGES;
+
+    if (checkpoint_running || backend != &sqlite_backend || db == NULL || threshold <= 0)
+        return;
+
+    if (_TimeSlime_QueryInt("SELECT journal_mode = 'wal' FROM pragma_journal_mode", &wal) != TIMESLIME_OK || !wal)
+        return;
+
+    memset(&checkpoint_stats, 0, sizeof(TIMESLIME_CHECKPOINT_STATS_t));
+    checkpoint_threshold = threshold;
+    checkpoint_wal_pages = 0;
+    checkpoint_done_pages = 0;
+    checkpoint_last_write = _TimeSlime_MonotonicMs();
+    checkpoint_stopping = 0;
+
+    if (pthread_create(&checkpoint_thread, NULL, _TimeSlime_Checkpoint_Worker, NULL) != 0)
+        return;
+
+    checkpoint_running = 1;
+    sqlite3_wal_hook(db, _TimeSlime_Checkpoint_WalHook, NULL);
+#endif
+}
+
+/**
+ * Stops the checkpoint thread and hands checkpoints back to SQLITE
+ */
+static void _TimeSlime_Checkpoint_Stop(void)
+{
+#ifndef _WIN32
+    if (!checkpoint_running)
+        return;
+
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint_stopping = 1;
+    pthread_cond_signal(&checkpoint_wake);
+    pthread_mutex_unlock(&checkpoint_lock);
+
+    pthread_join(checkpoint_thread, NULL);
+    checkpoint_running = 0;
+
+    // 1000 pages is SQLITE's default
+    if (db != NULL)
+        sqlite3_wal_autocheckpoint(db, 1000);
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * Called by SQLITE after every commit with the number of pages in the WAL
+ */
+static int _TimeSlime_Checkpoint_WalHook(void *ignoreMe, sqlite3 *conn, const char *schema, int pages)
+{
+    // Attached files are only read
+    if (strcmp(schema, "main") != 0)
+        return SQLITE_OK;
+
+    pthread_mutex_lock(&checkpoint_lock);
+    // Fewer pages than were checkpointed means the WAL started over from the top
+    if (pages < checkpoint_done_pages)
+        checkpoint_done_pages = 0;
+    checkpoint_wal_pages = pages;
+    checkpoint_last_write = _TimeSlime_MonotonicMs();
+    if (pages - checkpoint_done_pages >= checkpoint_threshold)
+        pthread_cond_signal(&checkpoint_wake);
+    pthread_mutex_unlock(&checkpoint_lock);
+
+    return SQLITE_OK;
+}
+
+/**
+ * Checkpoint thread, wakes every TIMESLIME_CHECKPOINT_INTERVAL (or when the WAL hook finds
+ * enough pages waiting) and runs a checkpoint when one is due. The connection is only opened
+ * the first time, so a short run that never needs a checkpoint never pays for it. It has no
+ * busy handler, a checkpoint that would have to wait on another connection gives up and
+ * is tried again later rather than holding anyone up.
+ */
+static void* _TimeSlime_Checkpoint_Worker(void *ignoreMe)
+{
+    sqlite3 *conn = NULL;
+    struct timespec until;
+    int mode;
+    int walPages;
+    int logPages = 0;
+    int checkpointed = 0;
+    int rc;
+    double started;
+    double elapsed;
+
+    pthread_mutex_lock(&checkpoint_lock);
+    while (!checkpoint_stopping)
+    {
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += TIMESLIME_CHECKPOINT_INTERVAL / 1000;
+        until.tv_nsec += (TIMESLIME_CHECKPOINT_INTERVAL % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&checkpoint_wake, &checkpoint_lock, &until);
+        if (checkpoint_stopping)
+            break;
+
+        walPages = checkpoint_wal_pages;
+        if (walPages - checkpoint_done_pages >= checkpoint_threshold)
+            mode = SQLITE_CHECKPOINT_PASSIVE;
+        else if (walPages > 0 && _TimeSlime_MonotonicMs() - checkpoint_last_write >= TIMESLIME_CHECKPOINT_IDLE)
+            mode = SQLITE_CHECKPOINT_TRUNCATE;
+        else
+            continue;
+        pthread_mutex_unlock(&checkpoint_lock);
+
+        // A new connection only finds out the database is in WAL mode once it has read from it
+        if (conn == NULL && (sqlite3_open_v2(database_file_path, &conn, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK ||
+                             sqlite3_exec(conn, "PRAGMA journal_mode", NULL, NULL, NULL) != SQLITE_OK))
+        {
+            sqlite3_close(conn);
+            conn = NULL;
+        }
+
+        started = _TimeSlime_MonotonicMs();
+        rc = (conn != NULL) ? sqlite3_wal_checkpoint_v2(conn, "main", mode, &logPages, &checkpointed) : SQLITE_CANTOPEN;
+        elapsed = _TimeSlime_MonotonicMs() - started;
+
+        pthread_mutex_lock(&checkpoint_lock);
+        checkpoint_stats.LastCheckpointMs = elapsed;
+        checkpoint_stats.TotalCheckpointMs += elapsed;
+        if (elapsed > checkpoint_stats.MaxCheckpointMs)
+            checkpoint_stats.MaxCheckpointMs = elapsed;
+
+        if (rc == SQLITE_OK && mode == SQLITE_CHECKPOINT_TRUNCATE)
+        {
+            checkpoint_stats.TruncateCheckpoints++;
+            // Unless something was committed meanwhile, the WAL is empty now
+            if (checkpoint_wal_pages == walPages)
+                checkpoint_wal_pages = 0;
+            checkpoint_done_pages = 0;
+        }
+        else if (rc == SQLITE_OK)
+        {
+            checkpoint_stats.Checkpoints++;
+            checkpoint_done_pages = checkpointed;
+            if (checkpointed < logPages)
+                checkpoint_stats.BusyCheckpoints++;
+        }
+        else
+        {
+            // Wait for another quiet spell (or more pages) before trying again
+            checkpoint_stats.BusyCheckpoints++;
+            checkpoint_last_write = _TimeSlime_MonotonicMs();
+            if (mode == SQLITE_CHECKPOINT_PASSIVE)
+                checkpoint_done_pages = walPages;
+        }
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
+
+    if (conn != NULL)
+        sqlite3_close(conn);
+
+    return NULL;
+}
+
+/**
+ * Milliseconds from a clock that never jumps, for timing checkpoints and quiet spells
+ */
+static double _TimeSlime_MonotonicMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+#endif
+
+/**
+ * Claims an idempotency key in a new write. original is set to _TIMESLIME_KEY_NEW when the
+ * key was free, the write is then left open for the request and _TimeSlime_Keyed_End.
+ * Otherwise it is set to the status the request returned the first time.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Keyed_Begin(char *key, int *nested, TIMESLIME_STATUS_t *original)
+{
+    int affected = 0;
+    char *sql;
+
+    if (!is_initialized)
+        return TIMESLIME_NOT_INITIALIZED;
+
+    if (backend != &sqlite_backend)
+        return TIMESLIME_NOT_SUPPORTED;
+
+    if (key == NULL || key[0] == '\0' || strlen(key) >= TIMESLIME_KEY_STR_LENGTH)
+        return TIMESLIME_INVALID_KEY;
+
+    *original = _TIMESLIME_KEY_NEW;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_BeginWrite(nested);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    sql = sqlite3_mprintf("INSERT INTO RequestKeys (Key) VALUES (%Q) ON CONFLICT DO NOTHING", key);
+    status = (sql != NULL) ? _TimeSlime_ExecuteChange(sql, &affected) : TIMESLIME_UNKOWN_ERROR;
+    sqlite3_free(sql);
+    if (status != TIMESLIME_OK || affected > 0)
+        return (status != TIMESLIME_OK) ? _TimeSlime_EndWrite(*nested, status) : TIMESLIME_OK;
+
+    // Seen before, nothing was written
+    sql = sqlite3_mprintf("SELECT Status FROM RequestKeys WHERE Key = %Q", key);
+    status = (sql != NULL) ? _TimeSlime_QueryInt(sql, original) : TIMESLIME_UNKOWN_ERROR;
+    sqlite3_free(sql);
+
+    return _TimeSlime_EndWrite(*nested, status);
+}
+
+/**
+ * Saves the result of a keyed request with its key and ends the write. Only results a
+ * retry would get again are kept; anything else (a busy database, invalid parameters)
+ * rolls the key back with the request, so a retry runs it for real.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Keyed_End(char *key, int nested, TIMESLIME_STATUS_t result)
+{
+    TIMESLIME_STATUS_t status = result;
+    char *sql;
+
+    if (result == TIMESLIME_OK || result == TIMESLIME_ALREADY_CLOCKED_IN || result == TIMESLIME_NOT_CLOCKED_IN)
+    {
+        sql = sqlite3_mprintf("UPDATE RequestKeys SET Status = %d WHERE Key = %Q", result, key);
+        status = (sql != NULL) ? _TimeSlime_ExecuteQuery(sql, 0) : TIMESLIME_UNKOWN_ERROR;
+        sqlite3_free(sql);
+    }
+
+    status = _TimeSlime_EndWrite(nested, status);
+    return (status == TIMESLIME_OK) ? result : status;
+}
+
+/**
+ * Starts a write, taking the write lock straight away. Inside a transaction that is
+ * already open (a batch of writes) a savepoint is used instead, so the write can still be
+ * undone on its own. nested is set to which one it was, for _TimeSlime_EndWrite.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_BeginWrite(int *nested)
+{
+    *nested = !sqlite3_get_autocommit(db);
+    return _TimeSlime_ExecuteQuery((*nested) ? "SAVEPOINT TimeSlimeWrite" : "BEGIN IMMEDIATE", 0);
+}
+
+/**
+ * Commits a write started by _TimeSlime_BeginWrite, or rolls it back when status is not OK
+ */
+static TIMESLIME_STATUS_t _TimeSlime_EndWrite(int nested, TIMESLIME_STATUS_t status)
+{
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_ExecuteQuery((nested) ? "RELEASE TimeSlimeWrite" : "COMMIT", 0);
+
+    if (status != TIMESLIME_OK)
+        sqlite3_exec(db, (nested) ? "ROLLBACK TO TimeSlimeWrite; RELEASE TimeSlimeWrite" : "ROLLBACK", NULL, 0, NULL);
+
+    return status;
+}
+
+/**
+ * Size of the database file in bytes, from its page count
+ */
+static TIMESLIME_STATUS_t _TimeSlime_DatabaseSize(long long *out)
+{
+    int pages = 0;
+    int pageSize = 0;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt("PRAGMA page_count", &pages);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt("PRAGMA page_size", &pageSize);
+
+    *out = (long long)pages * pageSize;
+    return status;
+}
+
+/**
+ * Reads every entry in the range of a watched report again
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Watch_Rebuild(TIMESLIME_WATCH_t *watch)
+{
+    char where[500];
+
+    memset(watch->DayHours, 0, watch->NumberOfDays * sizeof(double));
+    memset(watch->DayEntries, 0, watch->NumberOfDays * sizeof(int));
+    watch->NumberOfEntries = 0;
+    _TimeSlime_FormatSeconds(_TimeSlime_TimeToSeconds(TIMESLIME_TIME_NOW), watch->LastUpdate);
+
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt("SELECT COALESCE(MAX(ID), 0) FROM TimeSheet", &watch->LastID);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    char *startDate = _TimeSlime_Date2Str(watch->Start);
+    char *endDate = _TimeSlime_Date2Str(watch->End);
+    sprintf(where, __TS_QRY_ENTRY_DATE " BETWEEN %s AND %s", startDate, endDate);
+    free(startDate);
+    free(endDate);
+
+    status = _TimeSlime_SelectEntries(0, where);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    return _TimeSlime_Watch_Apply(watch);
+}
+
+/**
+ * Moves the hours of the entries just selected into the watched report,
+ * taking back whatever they added before
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Watch_Apply(TIMESLIME_WATCH_t *watch)
+{
+    TIMESLIME_DATE_t date;
+    int i;
+
+    for (i = 0; i < number_of_results; i++)
+    {
+        TIMESLIME_INTERNAL_ROW_t *row = database_results[i];
+        int day = -1;
+
+        // Open sessions and entries outside the range count for nothing, the same as in a report
+        int counted = (strcmp(row->ClockInTime, "NULL") != 0 && strcmp(row->ClockOutTime, "NULL") != 0) ||
+                        (strcmp(row->HoursAddedDate, "NULL") != 0 && row->HoursAdded != 0.0);
+        if (counted && TimeSlime_ParseDate(row->TimeSheetDate, &date) == TIMESLIME_OK)
+            day = (int)(_TimeSlime_DateToDays(date) - watch->StartDay);
+        if (day >= watch->NumberOfDays)
+            day = -1;
+
+        _TimeSlime_Watch_Set(watch, row->ID, day, row->TotalHours);
+
+        if (row->ID > watch->LastID)
+            watch->LastID = row->ID;
+    }
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Sets what an entry adds to a watched report, a day of -1 removes it
+ */
+static void _TimeSlime_Watch_Set(TIMESLIME_WATCH_t *watch, int id, int day, float hours)
+{
+    int low = 0;
+    int high = watch->NumberOfEntries;
+
+    // Binary search by ID, new entries almost always go at the end
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (watch->Entries[middle].ID < id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    TIMESLIME_WATCH_ENTRY_t *entry = &watch->Entries[low];
+    if (low < watch->NumberOfEntries && entry->ID == id)
+    {
+        watch->DayHours[entry->Day] -= entry->Hours;
+        watch->DayEntries[entry->Day]--;
+
+        if (day < 0)
+        {
+            memmove(entry, entry + 1, (watch->NumberOfEntries - low - 1) * sizeof(TIMESLIME_WATCH_ENTRY_t));
+            watch->NumberOfEntries--;
+            return;
+        }
+    }
+    else
+    {
+        if (day < 0)
+            return;
+
+        if (watch->NumberOfEntries == watch->EntriesSize)
+        {
+            int size = (watch->EntriesSize > 0) ? watch->EntriesSize * 2 : 64;
+            TIMESLIME_WATCH_ENTRY_t *entries = (TIMESLIME_WATCH_ENTRY_t*)realloc(watch->Entries, size * sizeof(TIMESLIME_WATCH_ENTRY_t));
+            if (entries == NULL)
+                return;
+
+            watch->Entries = entries;
+            watch->EntriesSize = size;
+            entry = &watch->Entries[low];
+        }
+
+        memmove(entry + 1, entry, (watch->NumberOfEntries - low) * sizeof(TIMESLIME_WATCH_ENTRY_t));
+        watch->NumberOfEntries++;
+        entry->ID = id;
+    }
+
+    entry->Day = day;
+    entry->Hours = hours;
+    watch->DayHours[day] += hours;
+    watch->DayEntries[day]++;
+}
+
+/**
+ * Checks if the database changed since the last check, by this or another connection
+ */
+static TIMESLIME_STATUS_t _TimeSlime_Watch_Version(TIMESLIME_WATCH_t *watch, int *changed)
+{
+    int version = 0;
+
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt("PRAGMA data_version", &version);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    int totalChanges = sqlite3_total_changes(db);
+    if (changed != NULL)
+        *changed = (version != watch->DataVersion || totalChanges != watch->TotalChanges);
+
+    watch->DataVersion = version;
+    watch->TotalChanges = totalChanges;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Fills in the report of a watch from its day totals and passes it to the callback
+ */
+static void _TimeSlime_Watch_Report(TIMESLIME_WATCH_t *watch)
+{
+    TIMESLIME_REPORT_t *report = watch->Report;
+    int i;
+
+    double total = 0;
+    report->NumberOfEntries = 0;
+    for (i = 0; i < watch->NumberOfDays; i++)
+    {
+        if (watch->DayEntries[i] == 0)
+            continue;
+
+        TIMESLIME_REPORT_ENTRY_t *entry = &report->Entries[report->NumberOfEntries++];
+        entry->Hours = watch->DayHours[i];
+        _TimeSlime_FormatDays(watch->StartDay + i, entry->Date);
+        total += watch->DayHours[i];
+    }
+    report->TotalHours = (float)total;
+
+    if (watch->Callback != NULL)
+        watch->Callback(report, watch->UserData);
+}
+
+/**
+ * Path of the status file in a directory, to be freed by the caller
+ */
+static char* _TimeSlime_StatusFilePath(char directory[])
+{
+    char *path = malloc((strlen(directory) + 2 + strlen(TIMESLIME_STATUS_FILE_NAME)) * sizeof(char)); /* + 2 for the slash and terminator */
+    if (path != NULL)
+        sprintf(path, "%s%s%s", directory, TIMESLIME_FILE_PATH_SEPARATOR, TIMESLIME_STATUS_FILE_NAME);
+
+    return path;
+}
+
+/**
+ * Rewrites the status file after a change to the time sheet. It is written to a temporary
+ * file of this process and renamed over the old one, so readers see the old or the new status
+ * and never a mix. The status is read and the file replaced while holding the write lock, so
+ * another process that changed the time sheet in between cannot have its newer status
+ * replaced by this older one.
+ * The time sheet is already changed when this runs, so a status that cannot be worked out or
+ * written removes the file rather than leave it out of date; the next initialize writes it again.
+ */
+static void _TimeSlime_WriteStatusFile(void)
+{
+    TIMESLIME_ENTRY_t open;
+    TIMESLIME_REPORT_t *report;
+    TIMESLIME_DATETIME_t clockIn;
+    int found = 0;
+    int nested = 0;
+    int replaced = 0;
+    long long clockInSeconds = 0;
+    double todayHours = 0;
+
+    if (status_file_path == NULL)
+        return;
+
+    TIMESLIME_STATUS_t status = TIMESLIME_OK;
+    if (backend == &sqlite_backend)
+        status = _TimeSlime_BeginWrite(&nested);
+    else if (backend == &log_backend)
+        status = _TimeSlime_Log_Begin();
+    if (status != TIMESLIME_OK)
+    {
+        remove(status_file_path);
+        return;
+    }
+
+    status = backend->GetOpenSession(&open, &found);
+    if (status == TIMESLIME_OK && found)
+    {
+        status = TimeSlime_ParseDateTime(open.ClockInTime, &clockIn);
+        clockInSeconds = _TimeSlime_TimeToSeconds(clockIn);
+    }
+
+    if (status == TIMESLIME_OK)
+        status = backend->GetReport(TIMESLIME_DATE_NOW, TIMESLIME_DATE_NOW, &report);
+    if (status == TIMESLIME_OK)
+    {
+        todayHours = report->TotalHours;
+        TimeSlime_FreeReport(&report);
+    }
+
+    char *tempPath = malloc((strlen(status_file_path) + 30) * sizeof(char)); /* Room for the process ID and .tmp */
+    if (status == TIMESLIME_OK && tempPath != NULL)
+    {
+        sprintf(tempPath, "%s.%d.tmp", status_file_path, (int)_TIMESLIME_PROCESS_ID());
+
+        FILE *file = fopen(tempPath, "w");
+        if (file == NULL)
+            status = TIMESLIME_STORAGE_ERROR;
+        else
+        {
+            if (fprintf(file, _TIMESLIME_STATUS_FORMAT, _TIMESLIME_STATUS_VERSION, (found) ? open.ID : 0, clockInSeconds,
+                        (long long)_TimeSlime_DateToDays(TIMESLIME_DATE_NOW), todayHours) < 0)
+                status = TIMESLIME_STORAGE_ERROR;
+            if (fclose(file) != 0)
+                status = TIMESLIME_STORAGE_ERROR;
+        }
+
+        // A rename that fails leaves the file as it was, whoever wrote it
+        if (status == TIMESLIME_OK)
+            replaced = (_TIMESLIME_REPLACE_FILE(tempPath, status_file_path) == 0);
+        if (!replaced)
+            remove(tempPath);
+    }
+
+    if (status != TIMESLIME_OK || tempPath == NULL)
+        remove(status_file_path);
+
+    // Nothing was changed, this only lets go of the write lock
+    if (backend == &sqlite_backend)
+        _TimeSlime_EndWrite(nested, TIMESLIME_OK);
+    else if (backend == &log_backend)
+        _TimeSlime_Log_End(TIMESLIME_OK);
+
+    free(tempPath);
+}
+
+/**
+ * Applies the configured storage settings to the open backend
+ */
+static TIMESLIME_STATUS_t _TimeSlime_ApplySettings(void)
+{
+    char sql[500];
+
+    if (!has_settings)
+        return TIMESLIME_OK;
+
+    if (backend == &log_backend)
+    {
+        log_sync_batch = (settings.LogSyncBatch > 0) ? settings.LogSyncBatch : 1;
+        return TIMESLIME_OK;
+    }
+
+    if (backend != &sqlite_backend || db == NULL)
+        return TIMESLIME_OK;
+
+    // page_size has to come before journal_mode, it can not change once in WAL mode
+    sprintf(sql,    "PRAGMA page_size = %d; " \
+                    "PRAGMA journal_mode = %s; " \
+                    "PRAGMA synchronous = %d; " \
+                    "PRAGMA mmap_size = %lld; " \
+                    "PRAGMA cache_size = %d; " \
+                    "PRAGMA temp_store = %d;",
+            settings.PageSize,
+            settings.JournalMode,
+            settings.Synchronous,
+            settings.MmapSize,
+            settings.CacheSize,
+            settings.TempStore
+        );
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Creates the SQL tables (only if the file is new)
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateTables(void)
+{
+    // Create time sheet table
+    char *sql =   "CREATE TABLE IF NOT EXISTS TimeSheet(" \
+                "ID INTEGER PRIMARY KEY AUTOINCREMENT," \
+                "HoursAdded REAL NOT NULL DEFAULT 0," \
+                "HoursAddedDate DATE DEFAULT NULL," \
+                "ClockInTime DATETIME DEFAULT NULL," \
+                "ClockOutTime DATETIME DEFAULT NULL," \
+                "CreationTime DATETIME DEFAULT (DATETIME('now', 'localtime')), " \
+                "LastUpdateTime DATETIME DEFAULT (DATETIME('now', 'localtime'))" \
+            "); " \
+            "CREATE INDEX IF NOT EXISTS HoursAdded_Index ON TimeSheet (HoursAddedDate);" \
+            "CREATE INDEX IF NOT EXISTS ClockIn_Index ON TimeSheet (ClockInTime);" \
+            "CREATE INDEX IF NOT EXISTS ClockOut_Index ON TimeSheet (ClockOutTime);";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Upgrades databases created by older versions of the library, one schema version at a time
+ */
+static TIMESLIME_STATUS_t _TimeSlime_MigrateTables(void)
+{
+    TIMESLIME_STATUS_t status;
+
+    status = _TimeSlime_MigrateStep(1, _TimeSlime_CreateIntervalIndex);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(2, _TimeSlime_CreateEntryDateIndexes);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(3, _TimeSlime_CreateUpdateTimeIndex);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(4, _TimeSlime_CreateStateTable);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(5, _TimeSlime_CreateProjects);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(6, _TimeSlime_CreateChangeFeed);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(7, _TimeSlime_CreateRequestKeys);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(8, _TimeSlime_CreateOpenJobIndex);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(9, _TimeSlime_CreateSyncLog);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_MigrateStep(10, _TimeSlime_CreateTotals);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    return _TimeSlime_MigrateStep(11, _TimeSlime_CreateJobColumn);
+}
+
+/**
+ * Runs a migration step in its own transaction if the database is older than version
+ */
+static TIMESLIME_STATUS_t _TimeSlime_MigrateStep(int version, TIMESLIME_STATUS_t (*step)(void))
+{
+    int current = 0;
+    char sql[100];
+
+    TIMESLIME_STATUS_t status = _TimeSlime_QueryInt("PRAGMA user_version", &current);
+    if (status != TIMESLIME_OK || current >= version)
+        return status;
+
+    sprintf(sql, "PRAGMA user_version = %d; COMMIT", version);
+
+    // Another process may be running the same migration, check again once holding the write lock
+    status = _TimeSlime_ExecuteQuery("BEGIN IMMEDIATE", 0);
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_QueryInt("PRAGMA user_version", &current);
+    if (status == TIMESLIME_OK && current >= version)
+        return _TimeSlime_ExecuteQuery("COMMIT", 0);
+    if (status == TIMESLIME_OK)
+        status = step();
+    if (status == TIMESLIME_OK)
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+    if (status != TIMESLIME_OK)
+        sqlite3_exec(db, "ROLLBACK", NULL, 0, NULL);
+
+    return status;
+}
+
+/**
+ * Creates the interval index over [ClockInTime, ClockOutTime] used for overlap and
+ * point in time queries. An R*Tree is used when SQLITE was built with it, otherwise
+ * a plain table with an index on the start of each interval takes its place.
+ * Triggers keep it in step with every insert, update and delete on the time sheet.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateIntervalIndex(void)
+{
+    char *sql;
+    TIMESLIME_STATUS_t status;
+
+    status = _TimeSlime_ExecuteQuery("CREATE VIRTUAL TABLE IF NOT EXISTS TimeSheetIntervals USING rtree_i32(ID, StartTime, EndTime)", 0);
+    if (status != TIMESLIME_OK)
+    {
+        sql =   "CREATE TABLE IF NOT EXISTS TimeSheetIntervals(" \
+                    "ID INTEGER PRIMARY KEY," \
+                    "StartTime INTEGER NOT NULL," \
+                    "EndTime INTEGER NOT NULL" \
+                "); " \
+                "CREATE INDEX IF NOT EXISTS Interval_Index ON TimeSheetIntervals (StartTime, EndTime);";
+
+        status = _TimeSlime_ExecuteQuery(sql, 0);
+        if (status != TIMESLIME_OK)
+            return status;
+    }
+
+    sql =   "CREATE TRIGGER IF NOT EXISTS TimeSheetIntervals_Insert AFTER INSERT ON TimeSheet " \
+            "WHEN NEW.ClockInTime IS NOT NULL BEGIN " \
+                "INSERT INTO TimeSheetIntervals (ID, StartTime, EndTime) SELECT " __TS_QRY_INTERVAL_VALUES("NEW") "; " \
+            "END; " \
+            "CREATE TRIGGER IF NOT EXISTS TimeSheetIntervals_Update AFTER UPDATE OF ClockInTime, ClockOutTime ON TimeSheet BEGIN " \
+                "DELETE FROM TimeSheetIntervals WHERE ID = OLD.ID; " \
+                "INSERT INTO TimeSheetIntervals (ID, StartTime, EndTime) SELECT " __TS_QRY_INTERVAL_VALUES("NEW") " WHERE NEW.ClockInTime IS NOT NULL; " \
+            "END; " \
+            "CREATE TRIGGER IF NOT EXISTS TimeSheetIntervals_Delete AFTER DELETE ON TimeSheet BEGIN " \
+                "DELETE FROM TimeSheetIntervals WHERE ID = OLD.ID; " \
+            "END; " \
+            "DELETE FROM TimeSheetIntervals; " \
+            "INSERT INTO TimeSheetIntervals (ID, StartTime, EndTime) " \
+                "SELECT " __TS_QRY_INTERVAL_VALUES("TimeSheet") " FROM TimeSheet WHERE ClockInTime IS NOT NULL;";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Creates the indexes on the date an entry belongs to, used to page through entries.
+ * The open sessions and added hours get partial indexes of their own, so paging
+ * through either never has to skip over the (much larger) set of closed sessions.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateEntryDateIndexes(void)
+{
+    char *sql = "CREATE INDEX IF NOT EXISTS EntryDate_Index ON TimeSheet (" __TS_QRY_ENTRY_DATE "); " \
+                "CREATE INDEX IF NOT EXISTS OpenEntryDate_Index ON TimeSheet (" __TS_QRY_ENTRY_DATE ") " \
+                    "WHERE " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES "; " \
+                "CREATE INDEX IF NOT EXISTS HoursEntryDate_Index ON TimeSheet (" __TS_QRY_ENTRY_DATE ") " \
+                    "WHERE " __TS_QRY_HOURS_ENTRIES ";";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Index for finding the entries changed since a point in time, used by watched reports
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateUpdateTimeIndex(void)
+{
+    return _TimeSlime_ExecuteQuery("CREATE INDEX IF NOT EXISTS LastUpdateTime_Index ON TimeSheet (LastUpdateTime)", 0);
+}
+
+/**
+ * Small named values the library keeps between runs, such as where verifying stopped
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateStateTable(void)
+{
+    return _TimeSlime_ExecuteQuery("CREATE TABLE IF NOT EXISTS TimeSlimeState(Name TEXT PRIMARY KEY, Value INTEGER NOT NULL DEFAULT 0)", 0);
+}
+
+/**
+ * Project names are kept once in their own table, entries only hold the ID. Reports by
+ * project sum each one over the (ProjectID, date) index.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateProjects(void)
+{
+    char *sql = "CREATE TABLE IF NOT EXISTS Projects(ID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE); " \
+                "ALTER TABLE TimeSheet ADD COLUMN ProjectID INTEGER DEFAULT NULL REFERENCES Projects(ID); " \
+                "CREATE INDEX IF NOT EXISTS ProjectEntryDate_Index ON TimeSheet (ProjectID, " __TS_QRY_ENTRY_DATE ");";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * The change feed keeps one row per entry holding the sequence of its latest change.
+ * Triggers replace that row on every insert, update and delete, and AUTOINCREMENT hands
+ * out a new, higher sequence each time, so the feed never grows past one row per entry
+ * (deleted ones included) and reading past a token is a seek on the primary key.
+ * Entries that existed before the feed are numbered in ID order.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateChangeFeed(void)
+{
+    char *sql = "CREATE TABLE IF NOT EXISTS TimeSheetChanges(" \
+                    "Sequence INTEGER PRIMARY KEY AUTOINCREMENT," \
+                    "EntryID INTEGER NOT NULL UNIQUE," \
+                    "Deleted INTEGER NOT NULL DEFAULT 0" \
+                "); " \
+                "CREATE TRIGGER IF NOT EXISTS TimeSheetChanges_Insert AFTER INSERT ON TimeSheet BEGIN " \
+                    "INSERT OR REPLACE INTO TimeSheetChanges (EntryID, Deleted) VALUES (NEW.ID, 0); " \
+                "END; " \
+                "CREATE TRIGGER IF NOT EXISTS TimeSheetChanges_Update AFTER UPDATE ON TimeSheet BEGIN " \
+                    "INSERT OR REPLACE INTO TimeSheetChanges (EntryID, Deleted) VALUES (NEW.ID, 0); " \
+                "END; " \
+                "CREATE TRIGGER IF NOT EXISTS TimeSheetChanges_Delete AFTER DELETE ON TimeSheet BEGIN " \
+                    "INSERT OR REPLACE INTO TimeSheetChanges (EntryID, Deleted) VALUES (OLD.ID, 1); " \
+                "END; " \
+                "INSERT OR IGNORE INTO TimeSheetChanges (EntryID) SELECT ID FROM TimeSheet ORDER BY ID;";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Idempotency keys of requests that already ran, with the status they returned.
+ * The key is the primary key, so looking one up is a single index seek.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateRequestKeys(void)
+{
+    char *sql = "CREATE TABLE IF NOT EXISTS RequestKeys(" \
+                    "Key TEXT PRIMARY KEY," \
+                    "Status INTEGER NOT NULL DEFAULT 0," \
+                    "CreationTime DATETIME DEFAULT (DATETIME('now', 'localtime'))" \
+                ") WITHOUT ROWID;";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Open sessions by job, only the few running timers are in it. Starting or stopping the
+ * timer of a job is one seek, however many jobs and closed sessions there are.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateOpenJobIndex(void)
+{
+    return _TimeSlime_ExecuteQuery("CREATE INDEX IF NOT EXISTS OpenJob_Index ON TimeSheet (ProjectID) " \
+                                        "WHERE " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES ";", 0);
+}
+
+/**
+ * Sync needs entries to keep one identity across machines. Entries made here have no Origin
+ * and are known everywhere by this machine's random ID and their own ID, imported entries keep
+ * where they came from. Deleting an entry leaves its origin in the change feed so the delete
+ * can be sent, and imported changes are marked there so they are not sent back.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateSyncLog(void)
+{
+    char *sql = "ALTER TABLE TimeSheet ADD COLUMN Origin INTEGER DEFAULT NULL; " \
+                "ALTER TABLE TimeSheet ADD COLUMN OriginID INTEGER DEFAULT NULL; " \
+                "CREATE UNIQUE INDEX IF NOT EXISTS Origin_Index ON TimeSheet (Origin, OriginID) WHERE Origin IS NOT NULL; " \
+                "ALTER TABLE TimeSheetChanges ADD COLUMN Imported INTEGER NOT NULL DEFAULT 0; " \
+                "ALTER TABLE TimeSheetChanges ADD COLUMN Origin INTEGER DEFAULT NULL; " \
+                "ALTER TABLE TimeSheetChanges ADD COLUMN OriginID INTEGER DEFAULT NULL; " \
+                "CREATE INDEX IF NOT EXISTS DeletedOrigin_Index ON TimeSheetChanges (Origin, OriginID) WHERE Deleted = 1; " \
+                "DROP TRIGGER IF EXISTS TimeSheetChanges_Delete; " \
+                "CREATE TRIGGER TimeSheetChanges_Delete AFTER DELETE ON TimeSheet BEGIN " \
+                    "INSERT OR REPLACE INTO TimeSheetChanges (EntryID, Deleted, Origin, OriginID) VALUES (OLD.ID, 1, OLD.Origin, OLD.OriginID); " \
+                "END; " \
+                "INSERT OR IGNORE INTO TimeSlimeState (Name, Value) VALUES ('SyncMachine', (RANDOM() & 2147483646) + 1);";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Running totals for TimeSlime_GetTotalHours, a Fenwick style tree kept in a table. Triggers add
+ * each entry to the one block holding its day on every level, so a write touches a row per level.
+ * The total of the days before any day is one block from each level where its day number has a
+ * bit set, so any range is a handful of primary key lookups however wide it is.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateTotals(void)
+{
+    char sql[6000];
+    sprintf(sql,    "CREATE TABLE IF NOT EXISTS TimeSheetTotalLevels(Level INTEGER PRIMARY KEY); " \
+                    "INSERT OR IGNORE INTO TimeSheetTotalLevels (Level) " \
+                        "WITH RECURSIVE Levels(Level) AS (SELECT 0 UNION ALL SELECT Level + 1 FROM Levels WHERE Level + 1 < %d) " \
+                        "SELECT Level FROM Levels; " \
+                    "CREATE TABLE IF NOT EXISTS TimeSheetTotals(" \
+                        "Level INTEGER NOT NULL," \
+                        "Block INTEGER NOT NULL," \
+                        "Seconds INTEGER NOT NULL DEFAULT 0," \
+                        "PRIMARY KEY (Level, Block)" \
+                    ") WITHOUT ROWID; " \
+                    "CREATE TRIGGER IF NOT EXISTS TimeSheetTotals_Insert AFTER INSERT ON TimeSheet BEGIN " \
+                        __TS_QRY_ADD_TOTALS("NEW", "") "; " \
+                    "END; " \
+                    "CREATE TRIGGER IF NOT EXISTS TimeSheetTotals_Update AFTER UPDATE OF HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime ON TimeSheet BEGIN " \
+                        __TS_QRY_ADD_TOTALS("OLD", "-") "; " \
+                        __TS_QRY_ADD_TOTALS("NEW", "") "; " \
+                    "END; " \
+                    "CREATE TRIGGER IF NOT EXISTS TimeSheetTotals_Delete AFTER DELETE ON TimeSheet BEGIN " \
+                        __TS_QRY_ADD_TOTALS("OLD", "-") "; " \
+                    "END; " \
+                    "DELETE FROM TimeSheetTotals; " \
+                    "INSERT INTO TimeSheetTotals (Level, Block, Seconds) " \
+                        "SELECT Level, Day >> Level, SUM(Seconds) " \
+                        "FROM (SELECT " __TS_QRY_DAY_NUMBER("TimeSheet") " AS Day, " __TS_QRY_ENTRY_SECONDS("TimeSheet") " AS Seconds FROM TimeSheet) Entries, TimeSheetTotalLevels " \
+                        "WHERE Day IS NOT NULL AND Seconds <> 0 " \
+                        "GROUP BY Level, Day >> Level;",
+            __TS_QRY_TOTAL_LEVELS
+        );
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Marks the sessions of job timers, so the plain clock has an open session of its own.
+ * The open session index moves under the mark, giving one seek for either kind. Plain
+ * clock in never opened a session next to another one, so every open session but the
+ * oldest was started as a job.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_CreateJobColumn(void)
+{
+    char *sql = "ALTER TABLE TimeSheet ADD COLUMN Job INTEGER NOT NULL DEFAULT 0; " \
+                "UPDATE TimeSheet SET Job = 1 WHERE " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES " " \
+                    "AND ID > (SELECT MIN(ID) FROM TimeSheet WHERE " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES "); " \
+                "DROP INDEX IF EXISTS OpenJob_Index; " \
+                "CREATE INDEX OpenJob_Index ON TimeSheet (Job, ProjectID) " \
+                    "WHERE " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES ";";
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Inserts an entry into the Time Slime time sheet
+ */
+static TIMESLIME_STATUS_t _TimeSlime_InsertEntry(TIMESLIME_INTERNAL_ROW_t *row)
+{
+    // Generate the SQL query
+    char sql[1000];
+    sprintf(sql,    "INSERT INTO TimeSheet " \
+                    "(HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, ProjectID, Job) " \
+                    "VALUES " \
+                    "(%.2f, %s, %s, %s, NULLIF(%d, 0), %d)",
+        row->HoursAdded,
+        row->HoursAddedDate,
+        row->ClockInTime,
+        row->ClockOutTime,
+        row->ProjectID,
+        row->Job
+    );
+
+    return _TimeSlime_ExecuteQuery(sql, 0);
+}
+
+/**
+ * Selects data from the database
+ */
+static TIMESLIME_STATUS_t _TimeSlime_SelectEntries(int minID, char *whereClause)
+{
+    number_of_results = 0;
+
+    char sql[1000];
+    sprintf(sql,    "SELECT " __TS_QRY_ENTRY_COLUMNS \
+                    "FROM TimeSheet " \
+                    "WHERE ID > %d AND %s " \
+                    "ORDER BY ID ASC",
+                minID,
+                (whereClause == NULL) ? "1=1" : whereClause
+            );
+
+    return _TimeSlime_ExecuteQuery(sql, 1);
+}
+
+/**
+ * Writes the FROM source for a report. Attached files whose span of dates misses the
+ * range are left out, the rest are combined with the time sheet through UNION ALL with
+ * the range applied to each one so they can use their own date index.
+ * Returns the number of attached files used.
+ */
+static int _TimeSlime_BuildReportSource(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, char *out)
+{
+    int i;
+    int used = 0;
+    int64_t startDay = _TimeSlime_DateToDays(start);
+    int64_t endDay = _TimeSlime_DateToDays(end);
+    char *startDate = _TimeSlime_Date2Str(start);
+    char *endDate = _TimeSlime_Date2Str(end);
+
+    strcpy(out, "TimeSheet");
+    for (i = 0; i < number_of_attached; i++)
+    {
+        if (attached[i].LastDay < startDay || attached[i].FirstDay > endDay)
+            continue;
+
+        if (used == 0)
+            sprintf(out, "(SELECT ID, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime FROM main.TimeSheet " \
+                            "WHERE " __TS_QRY_ENTRY_DATE " BETWEEN %s AND %s", startDate, endDate);
+
+        sprintf(out + strlen(out), " UNION ALL SELECT ID, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime FROM %s.TimeSheet " \
+                            "WHERE " __TS_QRY_ENTRY_DATE " BETWEEN %s AND %s", attached[i].Schema, startDate, endDate);
+        used++;
+    }
+    if (used > 0)
+        strcat(out, ")");
+
+    free(startDate);
     free(endDate);
-    endDate = NULL;
 
-    number_of_results = 0;
-    TIMESLIME_STATUS_t result = _TimeSlime_ExecuteQuery(sql, 1);
-    if (result != TIMESLIME_OK)
-        return result;
+    return used;
+}
+
+/**
+ * Executes a SQLITE query
+ */
+static TIMESLIME_STATUS_t _TimeSlime_ExecuteQuery(char *sql, int useCallback)
+{
+    return _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, (useCallback) ? _TIMESLIME_SQLITE_CALLBACK_WRAPPER : NULL, 0, &db_error));
+}
+
+
+/**
+ * Executes a single INSERT, UPDATE or DELETE in its own transaction (or savepoint, inside
+ * one that is already open), and reports how many rows it changed (rows changed by triggers
+ * are not counted). The write lock is taken up front, a read lock can not wait its way up
+ * to a write lock in WAL mode.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_ExecuteChange(char *sql, int *affected)
+{
+    int nested;
+    TIMESLIME_STATUS_t status = _TimeSlime_BeginWrite(&nested);
+    if (status != TIMESLIME_OK)
+        return status;
+
+    status = _TimeSlime_ExecuteQuery(sql, 0);
+    if (status == TIMESLIME_OK)
+        *affected = sqlite3_changes(db);
+
+    return _TimeSlime_EndWrite(nested, status);
+}
+
+/**
+ * Executes a SQLITE query that returns a single integer
+ */
+static TIMESLIME_STATUS_t _TimeSlime_QueryInt(char *sql, int *out)
+{
+    return _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_INT_CALLBACK, out, &db_error));
+}
+
+/**
+ * Runs a query whose single result is a 64 bit integer, like a sum of seconds
+ */
+static TIMESLIME_STATUS_t _TimeSlime_QueryInt64(char *sql, long long *out)
+{
+    return _TimeSlime_SqliteStatus(sqlite3_exec(db, sql, _TIMESLIME_SQLITE_INT64_CALLBACK, out, &db_error));
+}
+
+/**
+ * Converts a SQLITE result code, lock timeouts can be retried by the caller
+ */
+static TIMESLIME_STATUS_t _TimeSlime_SqliteStatus(int rc)
+{
+    switch (rc & 0xFF)
+    {
+        case SQLITE_OK:
+            return TIMESLIME_OK;
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+            return TIMESLIME_BUSY;
+        default:
+            return TIMESLIME_SQLITE_ERROR;
+    }
+}
+
+/**
+ * Called by SQLITE while another connection holds a lock. Backs off exponentially
+ * up to TIMESLIME_BUSY_MAX_BACKOFF per wait, and gives up after TIMESLIME_BUSY_TIMEOUT
+ */
+static int _TimeSlime_BusyHandler(void *ignoreMe, int attempts)
+{
+    int waited = 0;
+    int delay = 1;
+    int i;
+
+    for (i = 0; i < attempts; i++)
+    {
+        waited += delay;
+        delay = (delay * 2 < TIMESLIME_BUSY_MAX_BACKOFF) ? delay * 2 : TIMESLIME_BUSY_MAX_BACKOFF;
+    }
+
+    if (waited >= TIMESLIME_BUSY_TIMEOUT)
+        return 0;
+
+    _TIMESLIME_SLEEP_MS(delay);
+    return 1;
+}
+
+/**
+ * Copies the current query results into a list of entries for the caller
+ */
+static TIMESLIME_STATUS_t _TimeSlime_BuildEntries(TIMESLIME_ENTRIES_t **out)
+{
+    int i;
+
+    TIMESLIME_ENTRIES_t *entries = (TIMESLIME_ENTRIES_t*)malloc(sizeof(TIMESLIME_ENTRIES_t) + (number_of_results * sizeof(TIMESLIME_ENTRY_t)));
+    if (entries == NULL)
+        return TIMESLIME_UNKOWN_ERROR;
+
+    entries->NumberOfEntries = number_of_results;
+    for (i = 0; i < number_of_results; i++)
+    {
+        entries->Entries[i].ID = database_results[i]->ID;
+        entries->Entries[i].HoursAdded = database_results[i]->HoursAdded;
+        entries->Entries[i].Hours = database_results[i]->TotalHours;
+        strcpy(entries->Entries[i].HoursAddedDate, database_results[i]->HoursAddedDate);
+        strcpy(entries->Entries[i].ClockInTime, database_results[i]->ClockInTime);
+        strcpy(entries->Entries[i].ClockOutTime, database_results[i]->ClockOutTime);
+        strcpy(entries->Entries[i].TimeSheetDate, database_results[i]->TimeSheetDate);
+    }
+
+    *out = entries;
+
+    return TIMESLIME_OK;
+}
+
+
+/**
+ * Converts an entry filter into a WHERE clause
+ */
+static TIMESLIME_STATUS_t _TimeSlime_FilterToSql(TIMESLIME_FILTER_t filter, char *out)
+{
+    TIMESLIME_STATUS_t paramTest;
+    char *dateStr;
+
+    strcpy(out, "(1=1)");
+
+    if (!_TIMESLIME_IS_DATE_ANY(filter.start))
+    {
+        paramTest = _TimeSlime_VerifyDate(filter.start);
+        if (paramTest != TIMESLIME_OK)
+            return paramTest;
+
+        dateStr = _TimeSlime_Date2Str(filter.start);
+        sprintf(out + strlen(out), " AND " __TS_QRY_ENTRY_DATE " >= %s", dateStr);
+        free(dateStr);
+    }
+
+    if (!_TIMESLIME_IS_DATE_ANY(filter.end))
+    {
+        paramTest = _TimeSlime_VerifyDate(filter.end);
+        if (paramTest != TIMESLIME_OK)
+            return paramTest;
+
+        dateStr = _TimeSlime_Date2Str(filter.end);
+        sprintf(out + strlen(out), " AND " __TS_QRY_ENTRY_DATE " <= %s", dateStr);
+        free(dateStr);
+    }
+
+    if (filter.kind == TIMESLIME_ENTRY_KIND_CLOCK)
+        strcat(out, " AND " __TS_QRY_CLOCK_ENTRIES);
+    else if (filter.kind == TIMESLIME_ENTRY_KIND_HOURS)
+        strcat(out, " AND " __TS_QRY_HOURS_ENTRIES);
+
+    if (filter.state == TIMESLIME_ENTRY_STATE_OPEN)
+        strcat(out, " AND " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES);
+    else if (filter.state == TIMESLIME_ENTRY_STATE_CLOSED)
+        strcat(out, " AND " __TS_QRY_CLOSED_ENTRIES);
+
+    return TIMESLIME_OK;
+}
+
+
+/**
+ * Parses the return result from queries
+ */
+static int _TIMESLIME_SQLITE_CALLBACK_WRAPPER(void *ignoreMe, int numColumns, char **columns, char **columnNames)
+{
+    int i = number_of_results; // Current index
+
+    if (database_results[i] == NULL)
+        database_results[i] = (TIMESLIME_INTERNAL_ROW_t*)malloc(sizeof(TIMESLIME_INTERNAL_ROW_t));
+
+    database_results[i]->ID = atoi(columns[0]);
+    database_results[i]->HoursAdded = atof(columns[1] ? columns[1] : "0");
+    database_results[i]->TotalHours = atof(columns[5] ? columns[5] : "0");
+    strcpy(database_results[i]->HoursAddedDate, columns[2] ? columns[2] : "NULL");
+    strcpy(database_results[i]->ClockInTime, columns[3] ? columns[3] : "NULL");
+    strcpy(database_results[i]->ClockOutTime, columns[4] ? columns[4] : "NULL");
+    strcpy(database_results[i]->TimeSheetDate, columns[6] ? columns[6] : "NULL");
+
+    number_of_results++;
+
+    // Increase results array if needed
+    if (number_of_results >= result_array_size)
+    {
+        int old_size = result_array_size;
+        result_array_size = result_array_size * 2.5;
+        TIMESLIME_INTERNAL_ROW_t **new_results_pointer = (TIMESLIME_INTERNAL_ROW_t**)realloc(database_results, result_array_size * sizeof(TIMESLIME_INTERNAL_ROW_t*));
+        if (new_results_pointer != NULL)
+        {
+            database_results = new_results_pointer;
+
+            for (i = old_size; i < result_array_size; i++)
+                database_results[i] = NULL;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Passes each result row to an entry iterator, a non-zero return stops the query
+ */
+static int _TIMESLIME_SQLITE_ENTRY_CALLBACK(void *iterator, int numColumns, char **columns, char **columnNames)
+{
+    TIMESLIME_ITERATOR_t *it = (TIMESLIME_ITERATOR_t*)iterator;
+    TIMESLIME_ENTRY_t entry;
+
+    entry.ID = atoi(columns[0]);
+    entry.HoursAdded = atof(columns[1] ? columns[1] : "0");
+    entry.Hours = atof(columns[5] ? columns[5] : "0");
+    strcpy(entry.HoursAddedDate, columns[2] ? columns[2] : "NULL");
+    strcpy(entry.ClockInTime, columns[3] ? columns[3] : "NULL");
+    strcpy(entry.ClockOutTime, columns[4] ? columns[4] : "NULL");
+    strcpy(entry.TimeSheetDate, columns[6] ? columns[6] : "NULL");
+
+    return it->Callback(&entry, it->UserData);
+}
+
+
+/**
+ * Adds one entry to the running analysis, entries arrive in date and clock in order.
+ * Columns are the entry columns followed by the entry day, clock in and clock out in seconds.
+ */
+static int _TIMESLIME_SQLITE_ANALYZE_CALLBACK(void *analyzer, int numColumns, char **columns, char **columnNames)
+{
+    TIMESLIME_ANALYZER_t *state = (TIMESLIME_ANALYZER_t*)analyzer;
+    int64_t day = atoll(columns[7]);
+    double hours = atof(columns[5] ? columns[5] : "0");
+
+    if (day != state->Day)
+    {
+        _TimeSlime_Analyze_EndDay(state);
+        state->Day = day;
+        state->DayHours = 0;
+    }
+
+    state->DayHours += hours;
+    state->Out->TotalHours += hours;
+
+    if (columns[8] != NULL && columns[9] != NULL)
+        _TimeSlime_Analyze_Session(state, atoll(columns[8]), atoll(columns[9]), columns);
+
+    return 0;
+}
+
+/**
+ * Adds one entry to the payroll, closing the day and week it comes after
+ */
+static int _TIMESLIME_SQLITE_PAYROLL_CALLBACK(void *payroll, int numColumns, char **columns, char **columnNames)
+{
+    TIMESLIME_PAYROLL_STATE_t *state = (TIMESLIME_PAYROLL_STATE_t*)payroll;
+    int64_t day = atoll(columns[1]);
+    double hoursAdded = atof(columns[0] ? columns[0] : "0");
+    int64_t minutes = 0;
+
+    if (day != state->Day)
+    {
+        _TimeSlime_Payroll_EndDay(state);
+
+        // Weeks start on the same weekday, 1970-01-01 was a Thursday
+        int64_t week = day - (((day + 4 - state->Rules.WeekStart) % 7) + 7) % 7;
+        if (week != state->Week)
+        {
+            _TimeSlime_Payroll_EndWeek(state);
+            state->Week = week;
+        }
+
+        state->Day = day;
+        state->DayWorked = 0;
+    }
+
+    // Added hours are paid as they are, sessions between their rounded punches
+    if (hoursAdded != 0.0)
+    {
+        minutes = (int64_t)(hoursAdded * 60.0 + ((hoursAdded >= 0) ? 0.5 : -0.5));
+    }
+    else if (columns[2] != NULL && columns[3] != NULL)
+    {
+        minutes = _TimeSlime_Payroll_Round(&state->Rules, atoll(columns[3])) - _TimeSlime_Payroll_Round(&state->Rules, atoll(columns[2]));
+        if (minutes < 0)
+            minutes = 0;
+    }
+
+    state->DayWorked += minutes;
+
+    return 0;
+}
+
+/**
+ * Minutes since the unix epoch, rounded to the nearest multiple of the rounding rule
+ */
+static int64_t _TimeSlime_Payroll_Round(TIMESLIME_PAYROLL_RULES_t *rules, int64_t seconds)
+{
+    int64_t step = (rules->RoundMinutes > 0) ? rules->RoundMinutes * 60 : 60;
+    return _TIMESLIME_FLOOR_DIV(seconds + step / 2, step) * (step / 60);
+}
+
+/**
+ * Applies the break and daily overtime to the day being summed, then the weekly limit
+ */
+static void _TimeSlime_Payroll_EndDay(TIMESLIME_PAYROLL_STATE_t *state)
+{
+    TIMESLIME_PAYROLL_RULES_t *rules = &state->Rules;
+    int64_t worked = state->DayWorked;
+    int64_t paid;
+    int64_t overtime = 0;
+    int64_t breakMinutes = 0;
+    int i;
+
+    if (state->Day == INT64_MIN)
+        return;
 
-    // Generate report
-    TIMESLIME_REPORT_t *report = (TIMESLIME_REPORT_t*)malloc(sizeof(TIMESLIME_REPORT_t) + (number_of_results * sizeof(TIMESLIME_REPORT_ENTRY_t)));
-    if (report == NULL)
-        return TIMESLIME_UNKOWN_ERROR;
+    if (rules->BreakMinutes > 0 && worked > (int64_t)(rules->BreakAfterHours * 60))
+        breakMinutes = (rules->BreakMinutes < worked) ? rules->BreakMinutes : worked;
+    paid = worked - breakMinutes;
 
-    report->TotalHours = 0;
-    report->NumberOfEntries = number_of_results;
-    for (i = 0; i < number_of_results; i++)
+    if (rules->DailyOvertimeHours > 0 && paid > (int64_t)(rules->DailyOvertimeHours * 60))
+        overtime = paid - (int64_t)(rules->DailyOvertimeHours * 60);
+
+    // Only regular time counts towards the weekly limit, overtime is never paid twice
+    int64_t regular = paid - overtime;
+    int64_t weekLimit = (int64_t)(rules->WeeklyOvertimeHours * 60);
+    if (rules->WeeklyOvertimeHours > 0 && state->Regular[TIMESLIME_PAYROLL_WEEK] + regular > weekLimit)
     {
-        // Build report entries
-        report->Entries[i].Hours = database_results[i]->TotalHours;
-        report->TotalHours += report->Entries[i].Hours;
-        strcpy(report->Entries[i].Date, database_results[i]->TimeSheetDate);
+        int64_t over = state->Regular[TIMESLIME_PAYROLL_WEEK] + regular - weekLimit;
+        if (over > regular)
+            over = regular;
+        regular -= over;
+        overtime += over;
     }
 
-    *out = report;
+    state->Worked[TIMESLIME_PAYROLL_DAY] = 0;
+    state->Break[TIMESLIME_PAYROLL_DAY] = 0;
+    state->Regular[TIMESLIME_PAYROLL_DAY] = 0;
+    state->Overtime[TIMESLIME_PAYROLL_DAY] = 0;
+    for (i = TIMESLIME_PAYROLL_DAY; i <= TIMESLIME_PAYROLL_TOTAL; i++)
+    {
+        state->Worked[i] += worked;
+        state->Break[i] += breakMinutes;
+        state->Regular[i] += regular;
+        state->Overtime[i] += overtime;
+    }
 
-    return TIMESLIME_OK;
+    if (state->Callback != NULL)
+    {
+        TIMESLIME_PAYROLL_PERIOD_t period;
+        _TimeSlime_Payroll_Emit(state, TIMESLIME_PAYROLL_DAY, state->Day, &period);
+        state->Callback(&period, state->UserData);
+    }
 }
 
-/* Frees memory allocated for report used in report method */
-void TimeSlime_FreeReport(TIMESLIME_REPORT_t **report)
+/**
+ * Passes on the week being summed and starts a new one
+ */
+static void _TimeSlime_Payroll_EndWeek(TIMESLIME_PAYROLL_STATE_t *state)
 {
-    if (*report != NULL)
+    if (state->Week == INT64_MIN)
+        return;
+
+    if (state->Callback != NULL)
     {
-        free(*report);
-        *report = NULL;
+        TIMESLIME_PAYROLL_PERIOD_t period;
+        _TimeSlime_Payroll_Emit(state, TIMESLIME_PAYROLL_WEEK, state->Week, &period);
+        state->Callback(&period, state->UserData);
     }
+
+    state->Worked[TIMESLIME_PAYROLL_WEEK] = 0;
+    state->Break[TIMESLIME_PAYROLL_WEEK] = 0;
+    state->Regular[TIMESLIME_PAYROLL_WEEK] = 0;
+    state->Overtime[TIMESLIME_PAYROLL_WEEK] = 0;
 }
 
 /**
- * Converts status to friendly status code (or returns SQLITE error string)
+ * Fills in a payroll period from the minutes summed for it
  */
-char*  TimeSlime_StatusCode(TIMESLIME_STATUS_t status)
+static void _TimeSlime_Payroll_Emit(TIMESLIME_PAYROLL_STATE_t *state, int kind, int64_t day, TIMESLIME_PAYROLL_PERIOD_t *out)
 {
-    switch (status)
+    out->Kind = kind;
+    out->Start[0] = '\0';
+    if (day != INT64_MIN)
+        _TimeSlime_FormatDays(day, out->Start);
+
+    out->WorkedHours = (float)(state->Worked[kind] / 60.0);
+    out->BreakHours = (float)(state->Break[kind] / 60.0);
+    out->RegularHours = (float)(state->Regular[kind] / 60.0);
+    out->OvertimeHours = (float)(state->Overtime[kind] / 60.0);
+}
+
+/**
+ * Adds a closed clock session to the heatmap, length sketch, longest sessions and gaps
+ */
+static void _TimeSlime_Analyze_Session(TIMESLIME_ANALYZER_t *analyzer, int64_t clockIn, int64_t clockOut, char **columns)
+{
+    TIMESLIME_ANALYSIS_t *out = analyzer->Out;
+    int64_t time;
+    int64_t next;
+    int64_t day;
+    int weekday;
+    int i;
+
+    if (clockOut < clockIn)
+        clockOut = clockIn;
+
+    out->NumberOfSessions++;
+
+    // Spread the session over the hours it covers
+    for (time = clockIn; time < clockOut; time = next)
     {
-        case TIMESLIME_OK:
-            return "K";
-        case TIMESLIME_UNKOWN_ERROR:
-            return "UKNOWN";
-        case TIMESLIME_INVALID_YEAR:
-            return "INVALID_YEAR";
-        case TIMESLIME_INVALID_MONTH:
-            return "INVALID_MONTH";
-        case TIMESLIME_INVALID_DAY:
-            return "INVALID_DAY";
-        case TIMESLIME_INVALID_HOUR:
-            return "INVALID_HOUR";
-        case TIMESLIME_INVALID_MINUTE:
-            return "INVALID_MINUTE";
-        case TIMESLIME_ALREADY_CLOCKED_IN:
-            return "ALREADY_CLOCKED_IN";
-        case TIMESLIME_NOT_CLOCKED_IN:
-            return "NOT_CLOCKED_IN";
-        case TIMESLIME_NO_ENTIRES:
-            return "NO_TIMESHEET_ENTRIES";
-        case TIMESLIME_NOT_INITIALIZED:
-            return "NOT_INITIALIZED";
-        case TIMESLIME_SQLITE_ERROR:
-            return db_error;
+        next = (_TIMESLIME_FLOOR_DIV(time, 3600) + 1) * 3600;
+        if (next > clockOut)
+            next = clockOut;
 
-        default:
-            return "?";
+        day = _TIMESLIME_FLOOR_DIV(time, _TIMESLIME_SECONDS_PER_DAY);
+        weekday = (int)((day + 4) % 7); // 1970-01-01 was a Thursday
+        if (weekday < 0)
+            weekday += 7;
+
+        out->Heatmap[weekday][(time - day * _TIMESLIME_SECONDS_PER_DAY) / 3600] += (next - time) / 3600.0;
     }
 
-}
+    int64_t minutes = (clockOut - clockIn) / 60;
+    analyzer->SessionMinutes[(minutes < _TIMESLIME_ANALYSIS_BUCKETS - 1) ? minutes : _TIMESLIME_ANALYSIS_BUCKETS - 1]++;
+
+    // Break since the previous session, only within the same day
+    if (analyzer->LastClockOut != INT64_MIN && clockIn >= analyzer->LastClockOut &&
+        _TIMESLIME_FLOOR_DIV(clockIn, _TIMESLIME_SECONDS_PER_DAY) == _TIMESLIME_FLOOR_DIV(analyzer->LastClockOut, _TIMESLIME_SECONDS_PER_DAY))
+    {
+        double gap = (clockIn - analyzer->LastClockOut) / 3600.0;
+        analyzer->GapHours += gap;
+        out->NumberOfGaps++;
+        if (gap > out->LongestGapHours)
+            out->LongestGapHours = gap;
+    }
+    if (clockOut > analyzer->LastClockOut)
+        analyzer->LastClockOut = clockOut;
+
+    // Keep the longest sessions, longest first
+    float hours = (clockOut - clockIn) / 3600.0;
+    if (out->NumberOfLongest == TIMESLIME_ANALYSIS_LONGEST && hours <= out->Longest[TIMESLIME_ANALYSIS_LONGEST - 1].Hours)
+        return;
+
+    i = (out->NumberOfLongest < TIMESLIME_ANALYSIS_LONGEST) ? out->NumberOfLongest++ : TIMESLIME_ANALYSIS_LONGEST - 1;
+    for (; i > 0 && out->Longest[i - 1].Hours < hours; i--)
+        out->Longest[i] = out->Longest[i - 1];
 
+    TIMESLIME_ENTRY_t *entry = &out->Longest[i];
+    entry->ID = atoi(columns[0]);
+    entry->HoursAdded = 0;
+    entry->Hours = hours;
+    strcpy(entry->HoursAddedDate, "NULL");
+    strcpy(entry->ClockInTime, columns[3]);
+    strcpy(entry->ClockOutTime, columns[4]);
+    strcpy(entry->TimeSheetDate, columns[6] ? columns[6] : "NULL");
+}
 
+/**
+ * Moves the finished day into the rolling window and updates the peak averages
+ */
+static void _TimeSlime_Analyze_EndDay(TIMESLIME_ANALYZER_t *analyzer)
+{
+    TIMESLIME_ANALYSIS_t *out = analyzer->Out;
+    double average;
 
+    if (analyzer->Day == INT64_MIN)
+        return;
 
+    int slot = (int)(((analyzer->Day % _TIMESLIME_ANALYSIS_WINDOW) + _TIMESLIME_ANALYSIS_WINDOW) % _TIMESLIME_ANALYSIS_WINDOW);
+    analyzer->WindowDays[slot] = analyzer->Day;
+    analyzer->WindowHours[slot] = analyzer->DayHours;
+    out->NumberOfDays++;
 
+    // A window ending on a day without time never beats the one ending on the last day with time
+    average = _TimeSlime_Analyze_Average(analyzer, analyzer->Day, 7);
+    if (average > out->PeakAverage7Days)
+        out->PeakAverage7Days = average;
 
+    average = _TimeSlime_Analyze_Average(analyzer, analyzer->Day, 30);
+    if (average > out->PeakAverage30Days)
+        out->PeakAverage30Days = average;
+}
 
 /**
- * Creates the SQL tables (only if the file is new)
+ * Average hours per day over the days up to and including endDay
  */
-static TIMESLIME_STATUS_t _TimeSlime_CreateTables(void)
+static double _TimeSlime_Analyze_Average(TIMESLIME_ANALYZER_t *analyzer, int64_t endDay, int days)
 {
-    // Create time sheet table
-    char *sql =   "CREATE TABLE IF NOT EXISTS TimeSheet(" \
-                "ID INTEGER PRIMARY KEY AUTOINCREMENT," \
-                "HoursAdded REAL NOT NULL DEFAULT 0," \
-                "HoursAddedDate DATE DEFAULT NULL," \
-                "ClockInTime DATETIME DEFAULT NULL," \
-                "ClockOutTime DATETIME DEFAULT NULL," \
-                "CreationTime DATETIME DEFAULT (DATETIME('now', 'localtime')), " \
-                "LastUpdateTime DATETIME DEFAULT (DATETIME('now', 'localtime'))" \
-            "); " \
-            "CREATE INDEX IF NOT EXISTS HoursAdded_Index ON TimeSheet (HoursAddedDate);" \
-            "CREATE INDEX IF NOT EXISTS ClockIn_Index ON TimeSheet (ClockInTime);" \
-            "CREATE INDEX IF NOT EXISTS ClockOut_Index ON TimeSheet (ClockOutTime);";
+    double sum = 0;
+    int i;
 
-    return _TimeSlime_ExecuteQuery(sql, 0);
+    for (i = 0; i < _TIMESLIME_ANALYSIS_WINDOW; i++)
+    {
+        if (analyzer->WindowDays[i] > endDay - days && analyzer->WindowDays[i] <= endDay)
+            sum += analyzer->WindowHours[i];
+    }
+
+    return sum / days;
 }
 
 /**
- * Inserts an entry into the Time Slime time sheet
+ * Session length at a quantile, read from the per minute histogram
  */
-static TIMESLIME_STATUS_t _TimeSlime_InsertEntry(TIMESLIME_INTERNAL_ROW_t *row)
+static float _TimeSlime_Analyze_Quantile(TIMESLIME_ANALYZER_t *analyzer, double quantile)
 {
-    // Generate the SQL query
-    char sql[1000];
-    sprintf(sql,    "INSERT INTO TimeSheet " \
-                    "(HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime) " \
-                    "VALUES " \
-                    "(%.2f, %s, %s, %s)",
-        row->HoursAdded,
-        row->HoursAddedDate,
-        row->ClockInTime,
-        row->ClockOutTime
-    );
+    int seen = 0;
+    int i;
 
-    return _TimeSlime_ExecuteQuery(sql, 0);
+    int rank = (int)(quantile * analyzer->Out->NumberOfSessions);
+    if (rank >= analyzer->Out->NumberOfSessions)
+        rank = analyzer->Out->NumberOfSessions - 1;
+
+    for (i = 0; i < _TIMESLIME_ANALYSIS_BUCKETS; i++)
+    {
+        seen += analyzer->SessionMinutes[i];
+        if (seen > rank)
+            return i / 60.0f;
+    }
+
+    return 0;
 }
 
 /**
- * Updates an entry in the Time Slime time sheet
+ * Collects the ID and problems of each entry in a verify chunk
  */
-static TIMESLIME_STATUS_t _TimeSlime_UpdateEntry(TIMESLIME_INTERNAL_ROW_t *row)
+static int _TIMESLIME_SQLITE_VERIFY_CALLBACK(void *chunk, int numColumns, char **columns, char **columnNames)
 {
-    // Generate the SQL query
-    char sql[1000];
-    sprintf(sql,    "UPDATE TimeSheet " \
-                    "SET HoursAdded=%.2f, HoursAddedDate=%s, ClockInTime=%s, ClockOutTime=%s, LastUpdateTime=DATETIME('now', 'localtime') " \
-                    "WHERE ID = %d",
-        row->HoursAdded,
-        row->HoursAddedDate,
-        row->ClockInTime,
-        row->ClockOutTime,
-        row->ID
-    );
+    TIMESLIME_VERIFY_CHUNK_t *out = (TIMESLIME_VERIFY_CHUNK_t*)chunk;
+    if (out->NumberOfEntries >= TIMESLIME_VERIFY_CHUNK)
+        return 1;
 
-    return _TimeSlime_ExecuteQuery(sql, 0);
+    out->IDs[out->NumberOfEntries] = atoi(columns[0]);
+    out->Problems[out->NumberOfEntries] = atoi(columns[1]);
+    out->NumberOfEntries++;
+    return 0;
 }
 
 /**
- * Selects data from the database
+ * Sets the minutes of one day of a dense report
  */
-static TIMESLIME_STATUS_t _TimeSlime_SelectEntries(int minID, char *whereClause)
+static int _TIMESLIME_SQLITE_DENSE_CALLBACK(void *report, int numColumns, char **columns, char **columnNames)
 {
-    number_of_results = 0;
-
-    char sql[1000];
-    sprintf(sql,    "SELECT " \
-                    "ID, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, " \
-                    "case when HoursAdded <> 0.0 then HoursAdded else ((JULIANDAY(ClockOutTime) - JULIANDAY(ClockInTime)) * 24) end AS TotalHours, " \
-                    "case when HoursAddedDate IS NOT NULL then date(HoursAddedDate) else date(ClockInTime) end AS TimeSheetDate " \
-                    "FROM TimeSheet " \
-                    "WHERE ID > %d AND %s " \
-                    "ORDER BY ID ASC",
-                minID,
-                (whereClause == NULL) ? "1=1" : whereClause
-            );
+    TIMESLIME_DENSE_REPORT_t *out = (TIMESLIME_DENSE_REPORT_t*)report;
+    int day = atoi(columns[0]);
 
-    return _TimeSlime_ExecuteQuery(sql, 1);
+    if (day >= 0 && day < out->NumberOfDays && columns[1] != NULL)
+        out->Minutes[day] = atoi(columns[1]);
+    return 0;
 }
 
 /**
- * Executes a SQLITE query
+ * Adds one project to a project report, the last column is the size of the report
  */
-static TIMESLIME_STATUS_t _TimeSlime_ExecuteQuery(char *sql, int useCallback)
+static int _TIMESLIME_SQLITE_PROJECT_CALLBACK(void *report, int numColumns, char **columns, char **columnNames)
 {
-    if (sqlite3_exec(db, sql, (useCallback) ? _TIMESLIME_SQLITE_CALLBACK_WRAPPER : NULL, 0, &db_error) != SQLITE_OK)
-        return TIMESLIME_SQLITE_ERROR;
+    TIMESLIME_PROJECT_REPORT_t *out = (TIMESLIME_PROJECT_REPORT_t*)report;
+    if (out->NumberOfProjects >= atoi(columns[2]))
+        return 1;
 
-    return TIMESLIME_OK;
+    TIMESLIME_PROJECT_REPORT_ENTRY_t *entry = &out->Projects[out->NumberOfProjects++];
+    entry->Hours = (float)atof(columns[1]);
+    snprintf(entry->Project, TIMESLIME_PROJECT_STR_LENGTH, "%s", (columns[0] != NULL) ? columns[0] : "");
+    out->TotalHours += entry->Hours;
+    return 0;
 }
 
-
 /**
- * Parses the return result from queries
+ * Adds one record to a page of the change feed, the last column is the size of the page
  */
-static int _TIMESLIME_SQLITE_CALLBACK_WRAPPER(void *ignoreMe, int numColumns, char **columns, char **columnNames)
+static int _TIMESLIME_SQLITE_CHANGE_CALLBACK(void *changes, int numColumns, char **columns, char **columnNames)
 {
-    int i = number_of_results; // Current index
+    TIMESLIME_CHANGES_t *out = (TIMESLIME_CHANGES_t*)changes;
+    if (out->NumberOfChanges >= atoi(columns[10]))
+        return 1;
 
-    if (database_results[i] == NULL)
-        database_results[i] = (TIMESLIME_INTERNAL_ROW_t*)malloc(sizeof(TIMESLIME_INTERNAL_ROW_t));
+    TIMESLIME_CHANGE_t *change = &out->Changes[out->NumberOfChanges++];
+    change->Sequence = atoll(columns[0]);
+    change->Deleted = atoi(columns[2]);
+    change->Entry.ID = atoi(columns[1]);
+    change->Entry.HoursAdded = atof(columns[3] ? columns[3] : "0");
+    change->Entry.Hours = atof(columns[7] ? columns[7] : "0");
+    strcpy(change->Entry.HoursAddedDate, columns[4] ? columns[4] : "NULL");
+    strcpy(change->Entry.ClockInTime, columns[5] ? columns[5] : "NULL");
+    strcpy(change->Entry.ClockOutTime, columns[6] ? columns[6] : "NULL");
+    strcpy(change->Entry.TimeSheetDate, columns[8] ? columns[8] : "NULL");
+    snprintf(change->Project, TIMESLIME_PROJECT_STR_LENGTH, "%s", (columns[9] != NULL) ? columns[9] : "");
 
-    database_results[i]->ID = atoi(columns[0]);
-    database_results[i]->HoursAdded = atof(columns[1] ? columns[1] : "0");
-    database_results[i]->TotalHours = atof(columns[5] ? columns[5] : "0");
-    strcpy(database_results[i]->HoursAddedDate, columns[2] ? columns[2] : "NULL");
-    strcpy(database_results[i]->ClockInTime, columns[3] ? columns[3] : "NULL");
-    strcpy(database_results[i]->ClockOutTime, columns[4] ? columns[4] : "NULL");
-    strcpy(database_results[i]->TimeSheetDate, columns[6] ? columns[6] : "NULL");
+    out->NextToken = change->Sequence;
+    return 0;
+}
 
-    number_of_results++;
+/**
+ * Writes one change to a sync changeset
+ */
+static int _TIMESLIME_SQLITE_SYNC_CALLBACK(void *writer, int numColumns, char **columns, char **columnNames)
+{
+    TIMESLIME_SYNC_WRITER_t *out = (TIMESLIME_SYNC_WRITER_t*)writer;
+    int deleted = atoi(columns[0]);
+    int flags = 0;
 
-    // Increase results array if needed
-    if (number_of_results >= result_array_size)
+    if (deleted)
+        flags |= _TIMESLIME_SYNC_DELETED;
+    if (columns[1] != NULL && atoi(columns[1]) != out->Machine)
+        flags |= _TIMESLIME_SYNC_FOREIGN;
+    if (!deleted && columns[4] != NULL)
+        flags |= _TIMESLIME_SYNC_HOURS_DATE;
+    if (!deleted && columns[5] != NULL)
+        flags |= _TIMESLIME_SYNC_CLOCK_IN;
+    if (!deleted && columns[6] != NULL)
+        flags |= _TIMESLIME_SYNC_CLOCK_OUT;
+    if (!deleted && columns[8] != NULL)
+        flags |= _TIMESLIME_SYNC_PROJECT;
+    if (!deleted && columns[9] != NULL && atoi(columns[9]))
+        flags |= _TIMESLIME_SYNC_JOB;
+
+    fputc(flags, out->File);
+    if (flags & _TIMESLIME_SYNC_FOREIGN)
+        _TimeSlime_Sync_PutVarint(out->File, (uint64_t)atoi(columns[1]));
+    _TimeSlime_Sync_PutVarint(out->File, (uint64_t)atoll(columns[2]));
+
+    if (!deleted)
     {
-        int old_size = result_array_size;
-        result_array_size = result_array_size * 2.5;
-        TIMESLIME_INTERNAL_ROW_t **new_results_pointer = (TIMESLIME_INTERNAL_ROW_t**)realloc(database_results, result_array_size * sizeof(TIMESLIME_INTERNAL_ROW_t*));
-        if (new_results_pointer != NULL)
-        {
-            database_results = new_results_pointer;
+        long long clockIn = (columns[5] != NULL) ? atoll(columns[5]) : 0;
+        long long mantissa;
+        int shift;
 
-            for (i = old_size; i < result_array_size; i++)
-                database_results[i] = NULL;
+        // QUOTE gives every digit of the stored value, a plain column only 15
+        _TimeSlime_Sync_SplitHours((columns[3] != NULL) ? strtod(columns[3], NULL) : 0, &mantissa, &shift);
+        _TimeSlime_Sync_PutSigned(out->File, mantissa);
+        _TimeSlime_Sync_PutVarint(out->File, (uint64_t)shift);
+        if (flags & _TIMESLIME_SYNC_HOURS_DATE)
+            _TimeSlime_Sync_PutSigned(out->File, atoll(columns[4]));
+        if (flags & _TIMESLIME_SYNC_CLOCK_IN)
+            _TimeSlime_Sync_PutSigned(out->File, clockIn);
+        if (flags & _TIMESLIME_SYNC_CLOCK_OUT)
+            _TimeSlime_Sync_PutSigned(out->File, atoll(columns[6]) - clockIn);
+        _TimeSlime_Sync_PutSigned(out->File, atoll(columns[7] ? columns[7] : "0"));
+
+        if (flags & _TIMESLIME_SYNC_PROJECT)
+        {
+            size_t length = strlen(columns[8]);
+            _TimeSlime_Sync_PutVarint(out->File, length);
+            fwrite(columns[8], 1, length, out->File);
         }
     }
 
+    out->Out->Changes++;
+    return ferror(out->File) ? 1 : 0;
+}
+
+/**
+ * Reads the first column of a single row result as an integer
+ */
+static int _TIMESLIME_SQLITE_INT_CALLBACK(void *out, int numColumns, char **columns, char **columnNames)
+{
+    *(int*)out = (numColumns > 0 && columns[0] != NULL) ? atoi(columns[0]) : 0;
+    return 0;
+}
+
+/**
+ * Reads the first column of a single row result as a 64 bit integer
+ */
+static int _TIMESLIME_SQLITE_INT64_CALLBACK(void *out, int numColumns, char **columns, char **columnNames)
+{
+    *(long long*)out = (numColumns > 0 && columns[0] != NULL) ? strtoll(columns[0], NULL, 10) : 0;
     return 0;
 }
 
@@ -471,16 +5605,22 @@ static int _TIMESLIME_SQLITE_CALLBACK_WRAPPER(void *ignoreMe, int numColumns, ch
  */
 static TIMESLIME_STATUS_t _TimeSlime_VerifyTimestamp(TIMESLIME_DATETIME_t time)
 {
+    if (_TIMESLIME_IS_TIME_NOW(time))
+        return TIMESLIME_OK;
+
     TIMESLIME_STATUS_t dateResult = _TimeSlime_VerifyDate((TIMESLIME_DATE_t) { time.year, time.month, time.day });
     if (dateResult != TIMESLIME_OK)
         return dateResult;
 
-    if (time.hour < -1 || time.hour > 24)
+    if (time.hour < 0 || time.hour > 23)
         return TIMESLIME_INVALID_HOUR;
 
-    if (time.minute < -1 || time.minute > 60)
+    if (time.minute < 0 || time.minute > 59)
         return TIMESLIME_INVALID_MINUTE;
 
+    if (time.second < 0 || time.second > 59)
+        return TIMESLIME_INVALID_SECOND;
+
     return TIMESLIME_OK;
 }
 
@@ -489,16 +5629,81 @@ static TIMESLIME_STATUS_t _TimeSlime_VerifyTimestamp(TIMESLIME_DATETIME_t time)
  */
 static TIMESLIME_STATUS_t _TimeSlime_VerifyDate(TIMESLIME_DATE_t date)
 {
-    if (date.year < 0 || date.year > 9999)
+    if (_TIMESLIME_IS_DATE_TODAY(date))
+        return TIMESLIME_OK;
+
+    if (date.year < 1 || date.year > 9999)
+        return TIMESLIME_INVALID_YEAR;
+    if (date.month < 1 || date.month > 12)
+        return TIMESLIME_INVALID_MONTH;
+    if (date.day < 1 || date.day > _TimeSlime_DaysInMonth(date.year, date.month))
+        return TIMESLIME_INVALID_DAY;
+
+    return TIMESLIME_OK;
+}
+
+/**
+ * Reads the YYYY-MM-DD part of a date string and advances the cursor past it. Zero parts
+ * are rejected here, all zeros would otherwise pass verification as TIMESLIME_DATE_TODAY.
+ */
+static TIMESLIME_STATUS_t _TimeSlime_ParseDatePart(const char **cursor, TIMESLIME_DATE_t *date)
+{
+    char separator;
+
+    if (!_TimeSlime_ReadNumber(cursor, 4, 4, &date->year) || date->year == 0)
         return TIMESLIME_INVALID_YEAR;
-    if (date.month < 0 || date.month > 12)
+
+    separator = **cursor;
+    if (separator != '-' && separator != '/')
+        return TIMESLIME_INVALID_FORMAT;
+    (*cursor)++;
+
+    if (!_TimeSlime_ReadNumber(cursor, 1, 2, &date->month) || date->month == 0)
         return TIMESLIME_INVALID_MONTH;
-    if (date.day < 0 || date.day > 31)
+
+    if (**cursor != separator)
+        return TIMESLIME_INVALID_FORMAT;
+    (*cursor)++;
+
+    if (!_TimeSlime_ReadNumber(cursor, 1, 2, &date->day) || date->day == 0)
         return TIMESLIME_INVALID_DAY;
 
     return TIMESLIME_OK;
 }
 
+/**
+ * Reads an unsigned number of minDigits to maxDigits digits and advances the cursor past it
+ */
+static int _TimeSlime_ReadNumber(const char **cursor, int minDigits, int maxDigits, int *out)
+{
+    const char *c = *cursor;
+    int value = 0;
+    int digits = 0;
+
+    while (digits < maxDigits && *c >= '0' && *c <= '9')
+    {
+        value = (value * 10) + (*c - '0');
+        digits++;
+        c++;
+    }
+
+    if (digits < minDigits)
+        return 0;
+
+    *out = value;
+    *cursor = c;
+    return 1;
+}
+
+/**
+ * Number of days in a month (1 - 12), accounting for leap years
+ */
+static int _TimeSlime_DaysInMonth(int year, int month)
+{
+    int isLeap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days_in_month[month] + (month == 2 && isLeap);
+}
+
 /* Convert Structs to strings */
 static char* _TimeSlime_Time2Str(TIMESLIME_DATETIME_t time)
 {
@@ -506,7 +5711,7 @@ static char* _TimeSlime_Time2Str(TIMESLIME_DATETIME_t time)
     if (_TIMESLIME_IS_TIME_NOW(time))
         strcpy(result, "DATETIME('now', 'localtime')");
     else
-        sprintf(result, "DATETIME('%04d-%02d-%02d %02d:%02d:0')", time.year, time.month, time.day, time.hour, time.minute);
+        sprintf(result, "DATETIME('%04d-%02d-%02d %02d:%02d:%02d')", time.year, time.month, time.day, time.hour, time.minute, time.second);
     return result;
 }
 
@@ -519,3 +5724,77 @@ static char* _TimeSlime_Date2Str(TIMESLIME_DATE_t date)
         sprintf(result, "DATE('%04d-%02d-%02d')", date.year, date.month, date.day);
     return result;
 }
+
+/**
+ * Days since 1970-01-01 for a calendar date (proleptic Gregorian)
+ */
+static int64_t _TimeSlime_DaysFromCivil(int year, int month, int day)
+{
+    int64_t y = year - (month <= 2);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yearOfEra = y - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * Calendar date for a number of days since 1970-01-01
+ */
+static void _TimeSlime_CivilFromDays(int64_t days, int *year, int *month, int *day)
+{
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+    *day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    *month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/* Convert Structs to day and second counts, resolving the current date and time */
+static int64_t _TimeSlime_DateToDays(TIMESLIME_DATE_t date)
+{
+    if (_TIMESLIME_IS_DATE_TODAY(date))
+        return _TIMESLIME_FLOOR_DIV(_TimeSlime_TimeToSeconds(TIMESLIME_TIME_NOW), _TIMESLIME_SECONDS_PER_DAY);
+
+    return _TimeSlime_DaysFromCivil(date.year, date.month, date.day);
+}
+
+static int64_t _TimeSlime_TimeToSeconds(TIMESLIME_DATETIME_t time)
+{
+    if (_TIMESLIME_IS_TIME_NOW(time))
+        time = _TimeSlime_Now();
+
+    return _TimeSlime_DaysFromCivil(time.year, time.month, time.day) * _TIMESLIME_SECONDS_PER_DAY + time.hour * 3600 + time.minute * 60 + time.second;
+}
+
+/* Current local date and time */
+static TIMESLIME_DATETIME_t _TimeSlime_Now(void)
+{
+    time_t now = time(NULL);
+    struct tm *local = localtime(&now);
+
+    return (TIMESLIME_DATETIME_t){ local->tm_year + 1900, local->tm_mon + 1, local->tm_mday, local->tm_hour, local->tm_min, local->tm_sec };
+}
+
+/* Convert day and second counts to strings, in the same format SQLITE uses */
+static void _TimeSlime_FormatDays(int64_t days, char *out)
+{
+    int year, month, day;
+    _TimeSlime_CivilFromDays(days, &year, &month, &day);
+    sprintf(out, "%04d-%02d-%02d", year, month, day);
+}
+
+static void _TimeSlime_FormatSeconds(int64_t seconds, char *out)
+{
+    int64_t days = _TIMESLIME_FLOOR_DIV(seconds, _TIMESLIME_SECONDS_PER_DAY);
+    int64_t rest = seconds - days * _TIMESLIME_SECONDS_PER_DAY;
+
+    _TimeSlime_FormatDays(days, out);
+    sprintf(out + strlen(out), " %02d:%02d:%02d", (int)(rest / 3600), (int)((rest / 60) % 60), (int)(rest % 60));
+}
@@ -11,33 +11,138 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 
 /* Constants */
 /* These are used when you want to use the current date */
 #define TIMESLIME_DATE_NOW         (TIMESLIME_DATE_t){ 0, 0, 0}
-#define TIMESLIME_TIME_NOW         (TIMESLIME_DATETIME_t){ 0, 0, 0, -1, -1 }
+#define TIMESLIME_TIME_NOW         (TIMESLIME_DATETIME_t){ 0, 0, 0, -1, -1, 0 }
+
+/* Used in filters when a date range should not be limited */
+#define TIMESLIME_DATE_ANY         (TIMESLIME_DATE_t){ -1, -1, -1 }
+#define TIMESLIME_FILTER_ALL       (TIMESLIME_FILTER_t){ { -1, -1, -1 }, { -1, -1, -1 }, TIMESLIME_ENTRY_KIND_ALL, TIMESLIME_ENTRY_STATE_ANY }
 
 #ifndef TIMESLIME_DATABASE_FILE_NAME
 #define TIMESLIME_DATABASE_FILE_NAME    "timeslime.db"
 #endif
 
+/* Sidecar file with the open session and today's hours, read by TimeSlime_GetStatus without opening the database */
+#ifndef TIMESLIME_STATUS_FILE_NAME
+#define TIMESLIME_STATUS_FILE_NAME      "timeslime.status"
+#endif
+
+#ifndef TIMESLIME_LOG_FILE_NAME
+#define TIMESLIME_LOG_FILE_NAME         "timeslime.log"
+#endif
+
+/* The log backend syncs to disk after this many appends, or once this many seconds passed since the last sync */
+#ifndef TIMESLIME_LOG_SYNC_BATCH
+#define TIMESLIME_LOG_SYNC_BATCH            32
+#endif
+
+#ifndef TIMESLIME_LOG_SYNC_INTERVAL
+#define TIMESLIME_LOG_SYNC_INTERVAL         1
+#endif
+
+/* How long to keep retrying while another process holds the database lock, and the longest single wait (milliseconds) */
+#ifndef TIMESLIME_BUSY_TIMEOUT
+#define TIMESLIME_BUSY_TIMEOUT              5000
+#endif
+
+#ifndef TIMESLIME_BUSY_MAX_BACKOFF
+#define TIMESLIME_BUSY_MAX_BACKOFF          100
+#endif
+
+/* Most database files that can be attached for federated reports (SQLITE allows 10 by default) */
+#ifndef TIMESLIME_MAX_ATTACHED
+#define TIMESLIME_MAX_ATTACHED              10
+#endif
+
+/* Clock sessions older than this many months are compacted into daily totals, and how many days each compaction step covers */
+#ifndef TIMESLIME_RETENTION_MONTHS
+#define TIMESLIME_RETENTION_MONTHS          24
+#endif
+
+#ifndef TIMESLIME_COMPACT_CHUNK_DAYS
+#define TIMESLIME_COMPACT_CHUNK_DAYS        31
+#endif
+
+/* Entries verified per read (and per repair transaction) */
+#ifndef TIMESLIME_VERIFY_CHUNK
+#define TIMESLIME_VERIFY_CHUNK              500
+#endif
+
+/* Background checkpoints: WAL pages that start a passive checkpoint (when no settings are given), how often the
+   checkpoint thread looks at the WAL, and how long without writes before the WAL is checkpointed and truncated (milliseconds) */
+#ifndef TIMESLIME_CHECKPOINT_PAGES
+#define TIMESLIME_CHECKPOINT_PAGES          1000
+#endif
+
+#ifndef TIMESLIME_CHECKPOINT_INTERVAL
+#define TIMESLIME_CHECKPOINT_INTERVAL       250
+#endif
+
+#ifndef TIMESLIME_CHECKPOINT_IDLE
+#define TIMESLIME_CHECKPOINT_IDLE           2000
+#endif
+
 #ifndef TIMESLIME_DEFAULT_RESULT_LIMIT
 #define TIMESLIME_DEFAULT_RESULT_LIMIT      1000
 #endif
 
 #define TIMESLIME_DATETIME_STR_LENGTH   50
+#define TIMESLIME_PROJECT_STR_LENGTH    64
+#define TIMESLIME_KEY_STR_LENGTH        128
+
+/* Storage tuning profiles */
+#define TIMESLIME_PROFILE_DURABLE       "durable"       /* Every write is on disk before returning */
+#define TIMESLIME_PROFILE_BALANCED      "balanced"      /* WAL, a power loss may lose the last few writes */
+#define TIMESLIME_PROFILE_THROUGHPUT    "throughput"    /* No syncing, fastest writes */
+#define TIMESLIME_PROFILE_READMOSTLY    "readmostly"    /* Large cache and memory map for reports */
+
+/* Entry kinds for filters */
+#define TIMESLIME_ENTRY_KIND_ALL        0
+#define TIMESLIME_ENTRY_KIND_CLOCK      1   /* Clock in/out sessions */
+#define TIMESLIME_ENTRY_KIND_HOURS      2   /* Hours added to a date */
+
+/* Entry states for filters */
+#define TIMESLIME_ENTRY_STATE_ANY       0
+#define TIMESLIME_ENTRY_STATE_OPEN      1   /* Clocked in, but not out yet */
+#define TIMESLIME_ENTRY_STATE_CLOSED    2
+
+/* Problems found by verifying, an entry can have several */
+#define TIMESLIME_PROBLEM_OPEN          1   /* Open session older than another open one of the same job */
+#define TIMESLIME_PROBLEM_NEGATIVE      2   /* Clocked out before clocking in */
+#define TIMESLIME_PROBLEM_TOO_LONG      4   /* Session longer than a day, reported but never repaired */
+#define TIMESLIME_PROBLEM_MIXED         8   /* Both added hours and clock times on one entry */
+#define TIMESLIME_PROBLEM_DUPLICATE     16  /* Exact copy of an earlier entry */
 
 /* Result Codes */
 #define TIMESLIME_OK                0
 
 #define TIMESLIME_UNKOWN_ERROR      100
 #define TIMESLIME_SQLITE_ERROR      50
+#define TIMESLIME_STORAGE_ERROR     51  /* Reading or writing the log backend failed */
+#define TIMESLIME_BUSY              52  /* Another process held the database lock too long, safe to retry */
+#define TIMESLIME_INVALID_DATABASE  53  /* File to attach is missing, not a time sheet or already attached */
+#define TIMESLIME_TOO_MANY_DATABASES 54 /* TIMESLIME_MAX_ATTACHED files are already attached */
+#define TIMESLIME_NO_STATUS         55  /* Status file is missing or unreadable, initializing writes it again */
+#define TIMESLIME_ASYNC_NOT_STARTED 56  /* TimeSlime_StartAsync has not been called, or TimeSlime_StopAsync has */
+#define TIMESLIME_INVALID_CHANGESET 57  /* Sync file is missing, truncated or not a Time Slime changeset */
+#define TIMESLIME_INVALID_CURSOR    58  /* Entry a page continues after was deleted or has no date, list again from the start */
+#define TIMESLIME_LOG_CORRUPT       59  /* Log backend file has a damaged record before its end */
 
 #define TIMESLIME_INVALID_YEAR      10
 #define TIMESLIME_INVALID_MONTH     11
 #define TIMESLIME_INVALID_DAY       12
 #define TIMESLIME_INVALID_HOUR      13
 #define TIMESLIME_INVALID_MINUTE    14
+#define TIMESLIME_INVALID_SECOND    15
+#define TIMESLIME_INVALID_FORMAT    16
+#define TIMESLIME_INVALID_PROFILE   17
+#define TIMESLIME_INVALID_PROJECT   18  /* Project name is empty or longer than TIMESLIME_PROJECT_STR_LENGTH - 1 */
+#define TIMESLIME_INVALID_KEY       19  /* Idempotency key is empty or longer than TIMESLIME_KEY_STR_LENGTH - 1 */
 
 #define TIMESLIME_NOT_INITIALIZED   99
 
@@ -47,6 +152,8 @@
 
 #define TIMESLIME_NO_ENTIRES        80
 
+#define TIMESLIME_NOT_SUPPORTED     90  /* Not available with the selected storage backend */
+
 
 /* Datatypes */
 typedef int TIMESLIME_STATUS_t;
@@ -66,6 +173,7 @@ struct TIMESLIME_DATETIME_STRUCT
     int day;
     int hour;
     int minute;
+    int second;
 };
 typedef struct TIMESLIME_DATETIME_STRUCT TIMESLIME_DATETIME_t;
 
@@ -86,7 +194,258 @@ struct TIMESLIME_REPORT_STRUCT
 };
 typedef struct TIMESLIME_REPORT_STRUCT TIMESLIME_REPORT_t;
 
+// Time Sheet Report as one number per day, Minutes[i] is the day i days after Start (0 for days without entries)
+struct TIMESLIME_DENSE_REPORT_STRUCT
+{
+    TIMESLIME_DATE_t Start;
+    int NumberOfDays;
+    int64_t TotalMinutes;
+    int32_t Minutes[];
+};
+typedef struct TIMESLIME_DENSE_REPORT_STRUCT TIMESLIME_DENSE_REPORT_t;
+
+// Hours of one project in a project report
+struct TIMESLIME_PROJECT_REPORT_ENTRY_STRUCT
+{
+    float Hours;
+    char Project[TIMESLIME_PROJECT_STR_LENGTH];     /* Empty for entries without a project */
+};
+typedef struct TIMESLIME_PROJECT_REPORT_ENTRY_STRUCT TIMESLIME_PROJECT_REPORT_ENTRY_t;
+
+// Time Sheet Report by Project
+struct TIMESLIME_PROJECT_REPORT_STRUCT
+{
+    int NumberOfProjects;
+    float TotalHours;
+    TIMESLIME_PROJECT_REPORT_ENTRY_t Projects[];
+};
+typedef struct TIMESLIME_PROJECT_REPORT_STRUCT TIMESLIME_PROJECT_REPORT_t;
+
+// Called with the up to date report of a watch, the report belongs to the watch
+typedef void (*TIMESLIME_REPORT_CALLBACK_t)(TIMESLIME_REPORT_t *report, void *userdata);
+
+// Called by TimeSlime_DispatchAsync when an async request finished, result is the report of a report request (free it) or NULL
+typedef void (*TIMESLIME_ASYNC_CALLBACK_t)(TIMESLIME_STATUS_t status, void *result, void *userdata);
+
+// Report kept up to date as entries change, see TimeSlime_WatchReport
+typedef struct TIMESLIME_WATCH_STRUCT TIMESLIME_WATCH_t;
+
+// Raw Time Sheet Entry
+struct TIMESLIME_ENTRY_STRUCT
+{
+    int ID;
+    float HoursAdded;
+    float Hours;
+    char HoursAddedDate[TIMESLIME_DATETIME_STR_LENGTH];
+    char ClockInTime[TIMESLIME_DATETIME_STR_LENGTH];
+    char ClockOutTime[TIMESLIME_DATETIME_STR_LENGTH];
+    char TimeSheetDate[TIMESLIME_DATETIME_STR_LENGTH];
+};
+typedef struct TIMESLIME_ENTRY_STRUCT TIMESLIME_ENTRY_t;
+
+// List of Time Sheet Entries
+struct TIMESLIME_ENTRIES_STRUCT
+{
+    int NumberOfEntries;
+    TIMESLIME_ENTRY_t Entries[];
+};
+typedef struct TIMESLIME_ENTRIES_STRUCT TIMESLIME_ENTRIES_t;
+
+// Called for each entry when iterating, return non-zero to stop
+typedef int (*TIMESLIME_ENTRY_CALLBACK_t)(TIMESLIME_ENTRY_t *entry, void *userdata);
+
+// Latest change to one entry, see TimeSlime_ChangesSince
+struct TIMESLIME_CHANGE_STRUCT
+{
+    long long Sequence;                             /* Position in the change feed */
+    int Deleted;                                    /* The entry was deleted, only Entry.ID is set */
+    TIMESLIME_ENTRY_t Entry;                        /* The entry as it is now */
+    char Project[TIMESLIME_PROJECT_STR_LENGTH];     /* Empty for entries without a project */
+};
+typedef struct TIMESLIME_CHANGE_STRUCT TIMESLIME_CHANGE_t;
+
+// Page of the change feed
+struct TIMESLIME_CHANGES_STRUCT
+{
+    int NumberOfChanges;
+    long long NextToken;        /* Pass to the next call to continue after these changes */
+    TIMESLIME_CHANGE_t Changes[];
+};
+typedef struct TIMESLIME_CHANGES_STRUCT TIMESLIME_CHANGES_t;
+
+// Filter for selecting Time Sheet Entries
+struct TIMESLIME_FILTER_STRUCT
+{
+    TIMESLIME_DATE_t start;     /* TIMESLIME_DATE_ANY for no lower bound */
+    TIMESLIME_DATE_t end;       /* TIMESLIME_DATE_ANY for no upper bound */
+    int kind;                   /* TIMESLIME_ENTRY_KIND_* */
+    int state;                  /* TIMESLIME_ENTRY_STATE_* */
+};
+typedef struct TIMESLIME_FILTER_STRUCT TIMESLIME_FILTER_t;
+
+// Result of compacting old clock sessions
+struct TIMESLIME_COMPACTION_STRUCT
+{
+    int SessionsCompacted;      /* Clock sessions removed */
+    int DaysCompacted;          /* Daily total rows added in their place */
+    long long BytesBefore;      /* Database size before and after */
+    long long BytesAfter;
+    int NeedsConversion;        /* Older database, freed pages are reused but the file only shrinks after TimeSlime_EnableIncrementalVacuum */
+};
+typedef struct TIMESLIME_COMPACTION_STRUCT TIMESLIME_COMPACTION_t;
+
+// Called for each entry with problems, problems are TIMESLIME_PROBLEM_* flags
+typedef void (*TIMESLIME_PROBLEM_CALLBACK_t)(int id, int problems, int repaired, void *userdata);
+
+// Result of one verify run
+struct TIMESLIME_VERIFY_STRUCT
+{
+    int FirstID;                /* Range of entry IDs checked by this run */
+    int LastID;
+    int EntriesChecked;
+    int Problems;               /* Entries with problems */
+    int Repaired;               /* Entries repaired */
+    int Finished;               /* Reached the last entry, the next run starts over */
+};
+typedef struct TIMESLIME_VERIFY_STRUCT TIMESLIME_VERIFY_t;
+
+// Current Clock Status
+struct TIMESLIME_CLOCK_STATUS_STRUCT
+{
+    int ClockedIn;
+    int ID;                                             /* Open session, 0 when clocked out */
+    char ClockInTime[TIMESLIME_DATETIME_STR_LENGTH];
+    float SessionHours;                                 /* Hours since clocking in */
+    float TodayHours;                                   /* Hours today, including the open session */
+};
+typedef struct TIMESLIME_CLOCK_STATUS_STRUCT TIMESLIME_CLOCK_STATUS_t;
+
+// Work Pattern Analysis
+#define TIMESLIME_ANALYSIS_LONGEST  5
+
+struct TIMESLIME_ANALYSIS_STRUCT
+{
+    int NumberOfSessions;               /* Closed clock sessions */
+    int NumberOfDays;                   /* Days with any time on them */
+    float TotalHours;                   /* Sessions and added hours */
+    float Heatmap[7][24];               /* Session hours by day of week (0 = Sunday) and hour of day */
+    float Average7Days;                 /* Hours per day over the 7 and 30 days ending the range */
+    float Average30Days;
+    float PeakAverage7Days;             /* Highest 7 and 30 day averages anywhere in the range */
+    float PeakAverage30Days;
+    float MedianSessionHours;           /* Session length quantiles, to the minute for sessions under a day */
+    float P90SessionHours;
+    int NumberOfGaps;                   /* Breaks between sessions on the same day */
+    float AverageGapHours;
+    float LongestGapHours;
+    int NumberOfLongest;
+    TIMESLIME_ENTRY_t Longest[TIMESLIME_ANALYSIS_LONGEST];  /* Longest sessions, longest first */
+};
+typedef struct TIMESLIME_ANALYSIS_STRUCT TIMESLIME_ANALYSIS_t;
+
+// Payroll Rules
+struct TIMESLIME_PAYROLL_RULES_STRUCT
+{
+    int RoundMinutes;               /* Punches are rounded to the nearest multiple, 0 to keep them as they are */
+    float DailyOvertimeHours;       /* Paid hours in a day past this are overtime, 0 for no daily overtime */
+    float WeeklyOvertimeHours;      /* Regular hours in a week past this are overtime, 0 for no weekly overtime */
+    float BreakAfterHours;          /* Days with more hours than this... */
+    int BreakMinutes;               /* ...have this many unpaid minutes taken off, 0 for no break deduction */
+    int WeekStart;                  /* Day the payroll week starts on, 0 = Sunday */
+};
+typedef struct TIMESLIME_PAYROLL_RULES_STRUCT TIMESLIME_PAYROLL_RULES_t;
+
+#define TIMESLIME_PAYROLL_DEFAULT_RULES (TIMESLIME_PAYROLL_RULES_t){ 15, 8.0f, 40.0f, 6.0f, 30, 1 }
+
+#define TIMESLIME_PAYROLL_DAY       0
+#define TIMESLIME_PAYROLL_WEEK      1
+#define TIMESLIME_PAYROLL_TOTAL     2
 
+// Payroll for a day, a week or the whole range
+struct TIMESLIME_PAYROLL_PERIOD_STRUCT
+{
+    int Kind;                                   /* TIMESLIME_PAYROLL_* */
+    char Start[TIMESLIME_DATETIME_STR_LENGTH];  /* The day, or the first day of the week or range */
+    float WorkedHours;                          /* After rounding, before the break */
+    float BreakHours;
+    float RegularHours;
+    float OvertimeHours;
+};
+typedef struct TIMESLIME_PAYROLL_PERIOD_STRUCT TIMESLIME_PAYROLL_PERIOD_t;
+
+// Called for each day worked, and for each week after its last day
+typedef void (*TIMESLIME_PAYROLL_CALLBACK_t)(TIMESLIME_PAYROLL_PERIOD_t *period, void *userdata);
+
+// Storage Settings
+struct TIMESLIME_SETTINGS_STRUCT
+{
+    char *JournalMode;      /* SQLITE journal_mode: "DELETE", "TRUNCATE", "WAL", ... */
+    int Synchronous;        /* SQLITE synchronous: 0 = OFF, 1 = NORMAL, 2 = FULL */
+    long long MmapSize;     /* SQLITE mmap_size in bytes, 0 to disable */
+    int CacheSize;          /* SQLITE cache_size, pages when positive, KiB when negative */
+    int PageSize;           /* SQLITE page_size in bytes, only applies to new databases */
+    int TempStore;          /* SQLITE temp_store: 0 = DEFAULT, 1 = FILE, 2 = MEMORY */
+    int LogSyncBatch;       /* Records the log backend appends between syncs */
+    int CheckpointPages;    /* WAL pages that start a background checkpoint, 0 to leave checkpoints to SQLITE */
+};
+typedef struct TIMESLIME_SETTINGS_STRUCT TIMESLIME_SETTINGS_t;
+
+// Background Checkpoint Metrics
+struct TIMESLIME_CHECKPOINT_STATS_STRUCT
+{
+    int Running;                /* The checkpoint thread is running */
+    long long WalBytes;         /* Size of the WAL file now */
+    int WalPages;               /* Pages in the WAL after the last commit of this process */
+    int Checkpoints;            /* Passive checkpoints run once the WAL reached CheckpointPages */
+    int TruncateCheckpoints;    /* Checkpoints that also truncated the WAL, run once writes went quiet */
+    int BusyCheckpoints;        /* Checkpoints cut short by other readers or writers */
+    double LastCheckpointMs;    /* Time spent checkpointing */
+    double MaxCheckpointMs;
+    double TotalCheckpointMs;
+};
+typedef struct TIMESLIME_CHECKPOINT_STATS_STRUCT TIMESLIME_CHECKPOINT_STATS_t;
+
+// Result of a sync export or import
+struct TIMESLIME_SYNC_STRUCT
+{
+    int Changes;                /* Changes written to or read from the changeset */
+    int Applied;                /* Imported changes that changed this time sheet */
+    int Conflicts;              /* Imported changes skipped, the entry was changed here more recently */
+    long long Bytes;            /* Size of the changeset file */
+};
+typedef struct TIMESLIME_SYNC_STRUCT TIMESLIME_SYNC_t;
+
+// Storage Backend, parameters have already been verified when these are called
+struct TIMESLIME_BACKEND_STRUCT
+{
+    char *Name;
+    TIMESLIME_STATUS_t (*Open)(char directory[]);
+    TIMESLIME_STATUS_t (*Close)(void);
+    TIMESLIME_STATUS_t (*AddHours)(float hours, TIMESLIME_DATE_t date);                 /* Insert added hours */
+    TIMESLIME_STATUS_t (*ClockIn)(TIMESLIME_DATETIME_t time);                           /* Insert an open session */
+    TIMESLIME_STATUS_t (*ClockOut)(TIMESLIME_DATETIME_t time);                          /* Close the open session */
+    TIMESLIME_STATUS_t (*GetOpenSession)(TIMESLIME_ENTRY_t *out, int *found);           /* Open session lookup */
+    TIMESLIME_STATUS_t (*GetReport)(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out);  /* Range aggregate */
+    TIMESLIME_STATUS_t (*Iterate)(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata);
+};
+typedef struct TIMESLIME_BACKEND_STRUCT TIMESLIME_BACKEND_t;
+
+
+
+/* Select the storage backend (SQLITE by default), must be called before initializing */
+TIMESLIME_STATUS_t TimeSlime_SetBackend(TIMESLIME_BACKEND_t *backend);
+
+/* Get a built in storage backend by name, "sqlite" or "log" */
+TIMESLIME_BACKEND_t* TimeSlime_GetBackend(char *name);
+
+/* Get the settings for a named storage tuning profile (TIMESLIME_PROFILE_*) */
+TIMESLIME_STATUS_t TimeSlime_GetProfile(char *profile, TIMESLIME_SETTINGS_t *out);
+
+/* Apply a named storage tuning profile, before or after initializing */
+TIMESLIME_STATUS_t TimeSlime_Configure(char *profile);
+
+/* Apply custom storage settings, before or after initializing */
+TIMESLIME_STATUS_t TimeSlime_ConfigureSettings(TIMESLIME_SETTINGS_t settings);
 
 /* Initialize the Time Slime library */
 TIMESLIME_STATUS_t TimeSlime_Initialize(char directory_for_database[]);
@@ -94,21 +453,162 @@ TIMESLIME_STATUS_t TimeSlime_Initialize(char directory_for_database[]);
 /* Safely close out of the Time Slime library */
 TIMESLIME_STATUS_t TimeSlime_Close(void);
 
+/* Reads the open session and today's hours from the status file, does not need initializing */
+TIMESLIME_STATUS_t TimeSlime_GetStatus(char directory_for_database[], TIMESLIME_CLOCK_STATUS_t *out);
+
+/* Adds another time sheet database file to reports, such as last year's */
+TIMESLIME_STATUS_t TimeSlime_AttachDatabase(char *path);
+
+/* Removes every attached database file from reports */
+TIMESLIME_STATUS_t TimeSlime_DetachDatabases(void);
+
 /* Add to the Time Slime time sheet */
 TIMESLIME_STATUS_t TimeSlime_AddHours(float hours, TIMESLIME_DATE_t date);
 
+/* Add to the Time Slime time sheet, billed to a project (NULL for none) */
+TIMESLIME_STATUS_t TimeSlime_AddProjectHours(float hours, TIMESLIME_DATE_t date, char *project);
+
 /* Clock in to the Time Slime time sheet */
 TIMESLIME_STATUS_t TimeSlime_ClockIn(TIMESLIME_DATETIME_t time);
 
+/* Clock in to the Time Slime time sheet, billed to a project (NULL for none) */
+TIMESLIME_STATUS_t TimeSlime_ClockInProject(TIMESLIME_DATETIME_t time, char *project);
+
 /* Clock out of the Time Slime time sheet */
 TIMESLIME_STATUS_t TimeSlime_ClockOut(TIMESLIME_DATETIME_t time);
 
+/* Starts the timer of a job (a project), alongside any other running jobs */
+TIMESLIME_STATUS_t TimeSlime_ClockInJob(TIMESLIME_DATETIME_t time, char *job);
+
+/* Stops the timer of a job, leaving other running jobs open */
+TIMESLIME_STATUS_t TimeSlime_ClockOutJob(TIMESLIME_DATETIME_t time, char *job);
+
+/* TimeSlime_AddProjectHours that runs once per key, a retry with the same key returns the first result (project may be NULL) */
+TIMESLIME_STATUS_t TimeSlime_AddHoursKeyed(char *key, float hours, TIMESLIME_DATE_t date, char *project);
+
+/* TimeSlime_ClockInProject that runs once per key, a retry with the same key returns the first result (project may be NULL) */
+TIMESLIME_STATUS_t TimeSlime_ClockInKeyed(char *key, TIMESLIME_DATETIME_t time, char *project);
+
+/* TimeSlime_ClockOut that runs once per key, a retry with the same key returns the first result */
+TIMESLIME_STATUS_t TimeSlime_ClockOutKeyed(char *key, TIMESLIME_DATETIME_t time);
+
 /* Gets the time sheet for a period of time */
 TIMESLIME_STATUS_t TimeSlime_GetReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_t **out);
 
 /* Frees memory allocated for report used in report method */
 void TimeSlime_FreeReport(TIMESLIME_REPORT_t **report);
 
+/* Gets the total hours worked in a period of time from running totals, without reading the entries */
+TIMESLIME_STATUS_t TimeSlime_GetTotalHours(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, double *out);
+
+/* Gets the time sheet for a period of time as whole minutes per day, every day in the range included */
+TIMESLIME_STATUS_t TimeSlime_GetDenseReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_DENSE_REPORT_t **out);
+
+/* Minutes worked over count days of a dense report, starting at day first */
+int64_t TimeSlime_SumDenseReport(TIMESLIME_DENSE_REPORT_t *report, int first, int count);
+
+/* Formats the date of a day of a dense report as YYYY-MM-DD */
+void TimeSlime_DenseReportDate(TIMESLIME_DENSE_REPORT_t *report, int day, char out[TIMESLIME_DATETIME_STR_LENGTH]);
+
+/* Converts a dense report to a report with an entry for each day worked, free it with TimeSlime_FreeReport */
+TIMESLIME_STATUS_t TimeSlime_DenseToReport(TIMESLIME_DENSE_REPORT_t *dense, TIMESLIME_REPORT_t **out);
+
+/* Frees memory allocated for report used in dense report method */
+void TimeSlime_FreeDenseReport(TIMESLIME_DENSE_REPORT_t **report);
+
+/* Gets the hours of each project over a period of time */
+TIMESLIME_STATUS_t TimeSlime_GetProjectReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_PROJECT_REPORT_t **out);
+
+/* Frees memory allocated for report used in project report method */
+void TimeSlime_FreeProjectReport(TIMESLIME_PROJECT_REPORT_t **report);
+
+/* Builds a report that is kept up to date by TimeSlime_PollWatch, callback is called with it now and after every change */
+TIMESLIME_STATUS_t TimeSlime_WatchReport(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_REPORT_CALLBACK_t callback, void *userdata, TIMESLIME_WATCH_t **out);
+
+/* Applies changes made since the last poll to a watched report, changed is set when the report was updated */
+TIMESLIME_STATUS_t TimeSlime_PollWatch(TIMESLIME_WATCH_t *watch, int *changed);
+
+/* Frees a watched report */
+void TimeSlime_FreeWatch(TIMESLIME_WATCH_t **watch);
+
+/* Gets the WAL size and how long background checkpoints have taken so far */
+TIMESLIME_STATUS_t TimeSlime_GetCheckpointStats(TIMESLIME_CHECKPOINT_STATS_t *out);
+
+/* Starts the worker thread for async requests, fd becomes readable whenever requests have finished (not on Windows) */
+TIMESLIME_STATUS_t TimeSlime_StartAsync(int *fd);
+
+/* Finishes the queued async requests, calls their callbacks and stops the worker thread */
+TIMESLIME_STATUS_t TimeSlime_StopAsync(void);
+
+/* Calls the callbacks of finished async requests on the calling thread, returns how many were called */
+int TimeSlime_DispatchAsync(void);
+
+/* Queues TimeSlime_AddHours on the worker thread */
+TIMESLIME_STATUS_t TimeSlime_AddHoursAsync(float hours, TIMESLIME_DATE_t date, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata);
+
+/* Queues TimeSlime_ClockIn on the worker thread */
+TIMESLIME_STATUS_t TimeSlime_ClockInAsync(TIMESLIME_DATETIME_t time, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata);
+
+/* Queues TimeSlime_ClockOut on the worker thread */
+TIMESLIME_STATUS_t TimeSlime_ClockOutAsync(TIMESLIME_DATETIME_t time, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata);
+
+/* Queues TimeSlime_GetReport on the worker thread */
+TIMESLIME_STATUS_t TimeSlime_GetReportAsync(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_ASYNC_CALLBACK_t callback, void *userdata);
+
+/* Calls callback for every entry matching the filter */
+TIMESLIME_STATUS_t TimeSlime_IterateEntries(TIMESLIME_FILTER_t filter, TIMESLIME_ENTRY_CALLBACK_t callback, void *userdata);
+
+/* Gets the clock sessions in a date range that overlap another session */
+TIMESLIME_STATUS_t TimeSlime_FindOverlaps(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_ENTRIES_t **out);
+
+/* Gets the clock sessions that were open at a point in time */
+TIMESLIME_STATUS_t TimeSlime_ActiveAt(TIMESLIME_DATETIME_t time, TIMESLIME_ENTRIES_t **out);
+
+/* Gets a page of up to limit entries that come after the entry with after_id (0 for the first page), which must still exist */
+TIMESLIME_STATUS_t TimeSlime_ListEntries(TIMESLIME_FILTER_t filter, int after_id, int limit, TIMESLIME_ENTRIES_t **out);
+
+/* Deletes every entry matching the filter, affected is set to the number of entries deleted */
+TIMESLIME_STATUS_t TimeSlime_DeleteEntries(TIMESLIME_FILTER_t filter, int *affected);
+
+/* Moves every entry matching the filter by delta_minutes, affected is set to the number of entries changed */
+TIMESLIME_STATUS_t TimeSlime_AdjustEntries(TIMESLIME_FILTER_t filter, int delta_minutes, int *affected);
+
+/* Analyzes work patterns in a date range (TIMESLIME_DATE_ANY for no bound) in a single pass */
+TIMESLIME_STATUS_t TimeSlime_Analyze(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_ANALYSIS_t *out);
+
+/* Works out regular and overtime hours per day and week under payroll rules, in one pass over the entries */
+TIMESLIME_STATUS_t TimeSlime_Payroll(TIMESLIME_DATE_t start, TIMESLIME_DATE_t end, TIMESLIME_PAYROLL_RULES_t rules, TIMESLIME_PAYROLL_CALLBACK_t callback, void *userdata, TIMESLIME_PAYROLL_PERIOD_t *total);
+
+/* Replaces clock sessions older than months (0 for TIMESLIME_RETENTION_MONTHS) with one added hours entry per day and project */
+TIMESLIME_STATUS_t TimeSlime_Compact(int months, TIMESLIME_COMPACTION_t *out);
+
+/* Rewrites a database made before incremental vacuum in one full VACUUM, locking it until done, so compacting can shrink it */
+TIMESLIME_STATUS_t TimeSlime_EnableIncrementalVacuum(TIMESLIME_COMPACTION_t *out);
+
+/* Checks up to max_entries (0 for all) entries after where the last run stopped, repairing what it can when repair is set */
+TIMESLIME_STATUS_t TimeSlime_Verify(int max_entries, int repair, TIMESLIME_PROBLEM_CALLBACK_t callback, void *userdata, TIMESLIME_VERIFY_t *out);
+
+/* Gets up to limit entries changed since token (0 for every entry), oldest change first */
+TIMESLIME_STATUS_t TimeSlime_ChangesSince(long long token, int limit, TIMESLIME_CHANGES_t **out);
+
+/* Frees memory allocated for changes returned by TimeSlime_ChangesSince */
+void TimeSlime_FreeChanges(TIMESLIME_CHANGES_t **changes);
+
+/* Writes the changes made here since the last export (every entry when full is set) to a changeset file */
+TIMESLIME_STATUS_t TimeSlime_SyncExport(char *file_path, int full, TIMESLIME_SYNC_t *out);
+
+/* Applies a changeset file from another machine in one transaction, the latest change to an entry wins */
+TIMESLIME_STATUS_t TimeSlime_SyncImport(char *file_path, TIMESLIME_SYNC_t *out);
+
+/* Frees memory allocated for entries returned by the entry methods */
+void TimeSlime_FreeEntries(TIMESLIME_ENTRIES_t **entries);
+
+/* Parses a YYYY-MM-DD date (- or / separated) */
+TIMESLIME_STATUS_t TimeSlime_ParseDate(const char *str, TIMESLIME_DATE_t *out);
+
+/* Parses a YYYY-MM-DD[ HH:MM[:SS]] date and time (- or / separated) */
+TIMESLIME_STATUS_t TimeSlime_ParseDateTime(const char *str, TIMESLIME_DATETIME_t *out);
+
 /* Converts status to friendly error code (or returns SQLITE error string) */
 char*  TimeSlime_StatusCode(TIMESLIME_STATUS_t status);
 
@@ -117,10 +617,51 @@ char*  TimeSlime_StatusCode(TIMESLIME_STATUS_t status);
 /* Queries (Do not touch) */
 #define __TS_QRY_GET_COMPLTED_CLOCK_ENTRIES "(ClockInTime IS NOT NULL AND ClockOutTime IS NOT NULL)"
 #define __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES "(ClockOutTime IS NULL AND ClockInTime IS NOT NULL)"
+/* The open session of plain clock in and out, job timers are left out */
+#define __TS_QRY_GET_OPEN_SESSION "(Job = 0 AND " __TS_QRY_GET_PARTIAL_CLOCK_ENTRIES ")"
 #define __TS_QRY_GET_ADDED_HOURS "(HoursAdded <> 0.0 AND HoursAddedDate IS NOT NULL)"
 
 #define __TS_QRY_GET_ALL_ENTIRES __TS_QRY_GET_COMPLTED_CLOCK_ENTRIES " OR " __TS_QRY_GET_ADDED_HOURS
 
+/* Must match the expression in the entry date indexes exactly for them to be used */
+#define __TS_QRY_ENTRY_DATE "(case when HoursAddedDate IS NOT NULL then date(HoursAddedDate) else date(ClockInTime) end)"
+
+#define __TS_QRY_ENTRY_COLUMNS "ID, HoursAdded, HoursAddedDate, ClockInTime, ClockOutTime, " \
+                    "case when HoursAdded <> 0.0 then HoursAdded else ((JULIANDAY(ClockOutTime) - JULIANDAY(ClockInTime)) * 24) end AS TotalHours, " \
+                    __TS_QRY_ENTRY_DATE " AS TimeSheetDate "
+
+/* Hours an entry adds to a report */
+#define __TS_QRY_ENTRY_HOURS "(case when HoursAdded <> 0.0 then HoursAdded else ((JULIANDAY(ClockOutTime) - JULIANDAY(ClockInTime)) * 24) end)"
+
+#define __TS_QRY_CLOCK_ENTRIES "(ClockInTime IS NOT NULL)"
+#define __TS_QRY_HOURS_ENTRIES "(HoursAddedDate IS NOT NULL)"
+#define __TS_QRY_CLOSED_ENTRIES "(ClockOutTime IS NOT NULL OR ClockInTime IS NULL)"
+
+/* Whole seconds since the unix epoch */
+#define __TS_QRY_SECONDS(t) "CAST(ROUND((JULIANDAY(" t ") - 2440587.5) * 86400) AS INTEGER)"
+
+/* Interval index coordinates are whole minutes since the unix epoch, open sessions end at the largest coordinate */
+#define __TS_QRY_MINUTES(t) "CAST(ROUND((JULIANDAY(" t ") - 2440587.5) * 1440) AS INTEGER)"
+#define __TS_QRY_OPEN_INTERVAL_END "2147483647"
+
+/* Running totals are kept in whole seconds per day, days are counted from 0001-01-01 as day 1.
+   Level L of the totals holds the sum of each block of 2^L days, enough levels to reach 9999-12-31 */
+#define __TS_QRY_TOTAL_LEVELS 22
+#define __TS_QRY_DAY_NUMBER(row) "CAST(JULIANDAY(case when " row ".HoursAddedDate IS NOT NULL then date(" row ".HoursAddedDate) else date(" row ".ClockInTime) end) - 1721424.5 AS INTEGER)"
+#define __TS_QRY_ENTRY_SECONDS(row) "CAST(ROUND((case when " row ".HoursAdded <> 0.0 then " row ".HoursAdded else ((JULIANDAY(" row ".ClockOutTime) - JULIANDAY(" row ".ClockInTime)) * 24) end) * 3600) AS INTEGER)"
+
+/* Adds (sign "") or removes (sign "-") an entry from the block holding its day on every level */
+#define __TS_QRY_ADD_TOTALS(row, sign) \
+    "INSERT INTO TimeSheetTotals (Level, Block, Seconds) " \
+    "SELECT Level, " __TS_QRY_DAY_NUMBER(row) " >> Level, " sign __TS_QRY_ENTRY_SECONDS(row) " FROM TimeSheetTotalLevels " \
+    "WHERE " __TS_QRY_DAY_NUMBER(row) " IS NOT NULL AND " __TS_QRY_ENTRY_SECONDS(row) " <> 0 " \
+    "ON CONFLICT (Level, Block) DO UPDATE SET Seconds = Seconds + excluded.Seconds"
+
+/* End is clamped to the start so a bad clock out can never be rejected by the R*Tree */
+#define __TS_QRY_INTERVAL_VALUES(row) \
+    row ".ID, " __TS_QRY_MINUTES(row ".ClockInTime") ", " \
+    "MAX(" __TS_QRY_MINUTES(row ".ClockInTime") ", COALESCE(" __TS_QRY_MINUTES(row ".ClockOutTime") ", " __TS_QRY_OPEN_INTERVAL_END "))"
+
 
 /* Versioning, do not touch unless increasing the version */
 #define _TO_VERSION_STRING(v) "v"__TO_VERSION_STRING(v)
@@ -146,6 +687,7 @@ char*  TimeSlime_StatusCode(TIMESLIME_STATUS_t status);
 
 /* Date helper functions */
 #define _TIMESLIME_IS_DATE_TODAY(date) (date.year == 0 && date.month == 0 && date.day == 0)
+#define _TIMESLIME_IS_DATE_ANY(date) (date.year == -1 && date.month == -1 && date.day == -1)
 #define _TIMESLIME_IS_TIME_NOW(time) (time.year == 0 && time.month == 0 && time.day == 0 && time.hour == -1 && time.minute == -1)
 
 #endif
\ No newline at end of file